@@ -0,0 +1,627 @@
+#include <Arduino.h>
+#include <WiFi.h>
+#include <lwip/sockets.h>
+#include <sys/time.h>
+#include <esp_timer.h>
+
+#include "config.h"
+#include "web.h"
+#include "log.h"
+#include "mqtt.h"
+#include "bridge.h"
+#include "bridge_core.h"
+#include "mt.h"
+#include "hex.h"
+#include "tls.h"
+
+extern struct ConfigSettingsStruct ConfigSettings;
+
+WiFiServer server(TCP_LISTEN_PORT, MAX_SOCKET_CLIENTS);
+WiFiServer monitorServer(0, MAX_SOCKET_CLIENTS);
+WiFiServer captureServer(0, 1);
+WiFiServer tlsServer(0, BRIDGE_TLS_MAX);
+WiFiClient captureClient; // pcapng stream, one at a time
+WiFiClient client[MAX_SOCKET_CLIENTS];
+uint8_t slotFree[MAX_SOCKET_CLIENTS]; // stack of unused client[] slots
+uint8_t slotFreeCount = 0;
+bool slotBusy[MAX_SOCKET_CLIENTS];
+IPAddress clientIp[MAX_SOCKET_CLIENTS];
+IPAddress goneIp[MAX_SOCKET_CLIENTS]; // last disconnected peers, to tell reconnects from new clients
+uint8_t goneIpNext = 0;
+bool clientViaMonitor[MAX_SOCKET_CLIENTS]; // accepted on the monitor port, never promoted
+uint32_t clientSince[MAX_SOCKET_CLIENTS];  // millis() at accept
+
+SemaphoreHandle_t bridgeMutex = NULL;
+TaskHandle_t bridgeTaskHandle = NULL;
+TaskHandle_t bridgeWatchHandle = NULL;
+TaskHandle_t bridgeTlsHandle = NULL;
+
+bool bridgeServerStarted = false;
+bool monitorServerStarted = false;
+bool captureServerStarted = false;
+volatile bool socketStateChanged = false;
+volatile bool uartRxPending = false;
+volatile uint32_t uartRxTime = 0;
+esp_timer_handle_t batchTimer = NULL;
+QueueHandle_t logQueue = NULL;
+
+uint32_t bridgeMillis()
+{
+  return millis();
+}
+
+uint32_t bridgeMicros()
+{
+  return micros();
+}
+
+uint64_t bridgeTimeUs()
+{
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return (uint64_t)tv.tv_sec * 1000000 + tv.tv_usec;
+}
+
+int bridgeUartAvailable()
+{
+  return Serial2.available();
+}
+
+size_t bridgeUartRead(uint8_t *buf, size_t len)
+{
+  return Serial2.read(buf, len);
+}
+
+void bridgeUartWrite(const uint8_t *buf, size_t len)
+{
+  Serial2.write(buf, len);
+}
+
+int bridgeClientRecv(uint8_t cln, uint8_t *buf, size_t len)
+{
+  if (tlsActive(cln))
+    return tlsRecv(cln, buf, len);
+  return recv(clientFd[cln], buf, len, MSG_DONTWAIT);
+}
+
+int bridgeClientSend(uint8_t cln, const uint8_t *buf, size_t len)
+{
+  if (tlsActive(cln))
+    return tlsSend(cln, buf, len);
+  return send(clientFd[cln], buf, len, MSG_DONTWAIT);
+}
+
+void bridgeTimerArm(uint32_t us)
+{
+  esp_timer_stop(batchTimer);
+  esp_timer_start_once(batchTimer, us);
+}
+
+void bridgeBufLog(BridgeBuf *buf)
+{ // hand a reference to the log recorder, hex dumped later from loop()
+  bufRef(buf);
+  if (!logQueue || xQueueSend(logQueue, &buf, 0) != pdTRUE)
+  {
+    bufRelease(buf);
+    BridgeStats.logSkipped++;
+  }
+}
+
+void bridgeAllowRejected(const char *entry)
+{
+  LOG_W(LOG_SOURCE_NET, "[SOCK IP WHITELIST] Ignored entry: %s", entry);
+}
+
+void bridgeLock()
+{
+  if (bridgeMutex)
+    xSemaphoreTake(bridgeMutex, portMAX_DELAY);
+}
+
+void bridgeUnlock()
+{
+  if (bridgeMutex)
+    xSemaphoreGive(bridgeMutex);
+}
+
+void bridgeStatsReset()
+{ // caller holds bridgeLock()
+  bridgeCoreStatsReset();
+}
+
+void bridgeLatencyAdd(uint32_t us)
+{
+  BridgeLatencyStruct &lat = BridgeStats.latency[ConfigSettings.bridgeMode];
+  if (lat.samples == 0 || us < lat.minUs)
+    lat.minUs = us;
+  if (us > lat.maxUs)
+    lat.maxUs = us;
+  lat.sumUs += us;
+  lat.samples++;
+  uint8_t bucket = 0;
+  while (bucket < BRIDGE_LATENCY_BUCKETS - 1 && us >= BRIDGE_LATENCY_BOUNDS_US[bucket])
+    bucket++;
+  BridgeStats.latencyHist[bucket]++;
+}
+
+void bridgeUartError(hardwareSerial_error_t err)
+{ // called from the uart event task
+  if (err == UART_FIFO_OVF_ERROR || err == UART_BUFFER_FULL_ERROR)
+    BridgeStats.uartOverruns++;
+  else if (err != UART_NO_ERROR)
+    BridgeStats.uartErrors++;
+}
+
+void bridgeUartRx()
+{ // called from the uart event task
+  if (!uartRxPending)
+  {
+    uartRxTime = micros();
+    uartRxPending = true;
+  }
+  if (bridgeTaskHandle && ConfigSettings.bridgeMode == BRIDGE_MODE_TASK)
+  {
+    xTaskNotifyGive(bridgeTaskHandle);
+  }
+}
+
+void socketClientConnected(int client)
+{
+  if (ConfigSettings.connectedSocket[client] != true)
+  {
+    DEBUG_PRINT(F("Connected client "));
+    DEBUG_PRINTLN(client);
+    if (ConfigSettings.connectedClients == 0)
+    {
+      ConfigSettings.socketTime = millis();
+      DEBUG_PRINT(F("Socket time "));
+      DEBUG_PRINTLN(ConfigSettings.socketTime);
+      socketStateChanged = true;
+    }
+    ConfigSettings.connectedSocket[client] = true;
+    ConfigSettings.connectedClients++;
+  }
+}
+
+void socketClientDisconnected(int client)
+{
+  if (ConfigSettings.connectedSocket[client] != false)
+  {
+    DEBUG_PRINT(F("Disconnected client "));
+    DEBUG_PRINTLN(client);
+    goneIp[goneIpNext++ % MAX_SOCKET_CLIENTS] = clientIp[client];
+    ConfigSettings.connectedSocket[client] = false;
+    ConfigSettings.connectedClients--;
+    if (ConfigSettings.connectedClients == 0)
+    {
+      ConfigSettings.socketTime = millis();
+      DEBUG_PRINT(F("Socket time "));
+      DEBUG_PRINTLN(ConfigSettings.socketTime);
+      socketStateChanged = true;
+    }
+  }
+}
+
+void printSocketTraffic(const BridgeBuf *buf)
+{ // print to web console, BRIDGE_LOG_LINE_BYTES per line
+  char line[24 + BRIDGE_LOG_LINE_BYTES * 3];
+  const size_t dirLen = min(strlen(buf->dir), (size_t)24);
+  memcpy(line, buf->dir, dirLen);
+  const uint8_t *data = buf->data;
+  size_t bytes_read = buf->len;
+  while (bytes_read > 0)
+  {
+    const size_t chunk = min(bytes_read, (size_t)BRIDGE_LOG_LINE_BYTES);
+    const size_t len = dirLen + hexFormat(line + dirLen, data, chunk);
+    logWrite(LOG_LEVEL_DEBUG, LOG_SOURCE_TRAFFIC, buf->time, line, len);
+    data += chunk;
+    bytes_read -= chunk;
+  }
+}
+
+int primarySlot()
+{
+  for (byte cln = 0; cln < MAX_SOCKET_CLIENTS; cln++)
+  {
+    if (clientFd[cln] >= 0 && clientRole[cln] == CLIENT_ROLE_PRIMARY)
+      return cln;
+  }
+  return -1;
+}
+
+void clientAccepted(byte cln, bool monitorPort)
+{ // first client on the bridge port becomes primary, everyone else monitors
+  clientIp[cln] = client[cln].remoteIP();
+  BridgeStats.connects++;
+  for (byte i = 0; i < MAX_SOCKET_CLIENTS; i++)
+  {
+    if (goneIp[i] == clientIp[cln])
+    {
+      BridgeStats.reconnects++;
+      break;
+    }
+  }
+  clientRole[cln] = CLIENT_ROLE_MONITOR; // not the previous occupant's role
+  clientViaMonitor[cln] = monitorPort;
+  clientSince[cln] = millis();
+  const CLIENT_ROLE_t role = (!monitorPort && primarySlot() < 0) ? CLIENT_ROLE_PRIMARY : CLIENT_ROLE_MONITOR;
+  bridgeCoreClientOpen(cln, client[cln].fd(), role);
+  socketClientConnected(cln);
+  printLogMsg(String("[SOCK] Client ") + cln + " " + client[cln].remoteIP().toString() + (tlsActive(cln) ? " (TLS)" : "") + (role == CLIENT_ROLE_PRIMARY ? " connected as primary" : " connected as monitor"));
+}
+
+void clientGone(byte cln)
+{ // free the slot; if it was the primary, the newest client of the bridge port takes over
+  if (!slotBusy[cln])
+    return;
+  slotBusy[cln] = false;
+  slotFree[slotFreeCount++] = cln;
+  const bool wasPrimary = clientFd[cln] >= 0 && clientRole[cln] == CLIENT_ROLE_PRIMARY;
+  bridgeCoreClientReset(cln);
+  socketClientDisconnected(cln);
+  if (!wasPrimary)
+    return;
+  int next = -1;
+  for (byte i = 0; i < MAX_SOCKET_CLIENTS; i++)
+  {
+    if (clientFd[i] >= 0 && !clientViaMonitor[i] && (next < 0 || clientSince[i] - clientSince[next] < 0x80000000UL))
+      next = i;
+  }
+  if (next >= 0)
+  { // e.g. z2m restarted on another host while the old connection was still timing out
+    clientRole[next] = CLIENT_ROLE_PRIMARY;
+    printLogMsg(String("[SOCK] Client ") + next + " " + clientIp[next].toString() + " promoted to primary");
+  }
+}
+
+void bridgeClientLost(uint8_t cln, bool evicted)
+{ // called by the core, dead peers are dropped as soon as they are noticed
+  if (evicted)
+    printLogMsg(String("[SOCK] Client ") + cln + " " + clientIp[cln].toString() + " evicted, tx queue overflow");
+  tlsClose(cln);
+  client[cln].stop();
+  clientGone(cln);
+}
+
+void batchTimerFired(void *arg)
+{ // esp_timer task
+  if (bridgeTaskHandle && ConfigSettings.bridgeMode == BRIDGE_MODE_TASK)
+  {
+    xTaskNotifyGive(bridgeTaskHandle);
+  }
+}
+
+uint32_t ipHostOrder(const IPAddress &ip)
+{
+  return ((uint32_t)ip[0] << 24) | ((uint32_t)ip[1] << 16) | ((uint32_t)ip[2] << 8) | ip[3];
+}
+
+bool clientAllowed(WiFiClient &incoming)
+{ // allow-list, stops the connection if it is not on it
+  if (!ConfigSettings.fwEnabled || bridgeAllowMatch(ipHostOrder(incoming.remoteIP())))
+    return true;
+  printLogMsg(String("[SOCK IP WHITELIST] Rejected connection from unknown IP: ") + incoming.remoteIP().toString());
+  BridgeStats.rejected++;
+  incoming.stop();
+  return false;
+}
+
+int slotTake(WiFiClient &incoming)
+{ // next slot off the free list, -1 (connection stopped) if there is none
+  if (slotFreeCount == 0)
+  {
+    printLogMsg(String("[SOCK] No free slot for ") + incoming.remoteIP().toString());
+    BridgeStats.rejected++;
+    incoming.stop();
+    return -1;
+  }
+  const byte cln = slotFree[--slotFreeCount];
+  slotBusy[cln] = true;
+  client[cln] = incoming;
+  return cln;
+}
+
+void acceptClients(WiFiServer &srv, bool monitorPort)
+{ // one available() per pending connection, slots come off the free list
+  for (byte n = 0; n < MAX_SOCKET_CLIENTS && srv.hasClient(); n++)
+  { // bounded, a connection storm is spread over several passes
+    WiFiClient incoming = srv.available();
+    if (!incoming)
+      break;
+    if (!clientAllowed(incoming))
+      continue;
+    const int cln = slotTake(incoming);
+    if (cln >= 0)
+      clientAccepted(cln, monitorPort);
+  }
+}
+
+void bridgeTlsTask(void *param)
+{ // handshakes block on the peer and on ECDHE math, so they run here and not under the bridge lock
+  if (!tlsInit())
+  {
+    bridgeLock();
+    tlsServer.end();
+    bridgeTlsHandle = NULL;
+    bridgeUnlock();
+    vTaskDelete(NULL);
+  }
+  for (;;)
+  {
+    vTaskDelay(pdMS_TO_TICKS(BRIDGE_IDLE_MS));
+    if (!tlsServer.hasClient())
+      continue;
+    WiFiClient incoming = tlsServer.available();
+    if (!incoming)
+      continue;
+    bridgeLock();
+    const bool allowed = clientAllowed(incoming);
+    const bool full = allowed && tlsCount() >= BRIDGE_TLS_MAX;
+    if (full)
+      BridgeStats.rejected++;
+    bridgeUnlock();
+    if (!allowed)
+      continue;
+    if (full)
+    {
+      LOG_W(LOG_SOURCE_NET, "[TLS] Session limit reached, rejected %s", incoming.remoteIP().toString().c_str());
+      incoming.stop();
+      continue;
+    }
+    TlsSession *tls = tlsHandshake(incoming.fd());
+    if (!tls)
+    {
+      incoming.stop();
+      continue;
+    }
+    bridgeLock();
+    const int cln = slotTake(incoming);
+    if (cln >= 0)
+    {
+      tlsAttach(cln, tls);
+      clientAccepted(cln, false);
+    }
+    else
+    {
+      tlsFree(tls);
+    }
+    bridgeUnlock();
+  }
+}
+
+void captureService()
+{ // a new capture client replaces the previous one
+  if (captureServer.hasClient())
+  {
+    WiFiClient incoming = captureServer.available();
+    if (incoming && (!ConfigSettings.fwEnabled || bridgeAllowMatch(ipHostOrder(incoming.remoteIP()))))
+    {
+      captureClient.stop();
+      captureClient = incoming;
+      bridgeCaptureStart(captureClient.fd());
+      printLogMsg(String("[SOCK] Capture to ") + captureClient.remoteIP().toString());
+    }
+    else
+    {
+      incoming.stop();
+      BridgeStats.rejected++;
+    }
+  }
+  if (captureClient && !bridgeCaptureDrain())
+  {
+    bridgeCaptureStop();
+    captureClient.stop();
+    printLogMsg("[SOCK] Capture client gone");
+  }
+}
+
+void bridgeService()
+{
+  BridgeCoreSettings.coalesce = ConfigSettings.bridgeCoalesce;
+  BridgeCoreSettings.coalesceUs = ConfigSettings.coalesceUs;
+  BridgeCoreSettings.coalesceBytes = ConfigSettings.coalesceBytes;
+  BridgeCoreSettings.keepIdle = ConfigSettings.keepIdle;
+  BridgeCoreSettings.keepIntvl = ConfigSettings.keepIntvl;
+  BridgeCoreSettings.keepCount = ConfigSettings.keepCount;
+  BridgeCoreSettings.writeDeadlineMs = ConfigSettings.writeDeadlineMs;
+  BridgeCoreSettings.holdMs = ConfigSettings.holdMs;
+
+  acceptClients(server, false);
+  if (monitorServerStarted)
+  {
+    acceptClients(monitorServer, true);
+  }
+
+  if (bridgeCoreService())
+  {
+    if (uartRxPending && ConfigSettings.connectedClients > 0)
+    {
+      bridgeLatencyAdd(micros() - uartRxTime);
+    }
+    uartRxPending = false;
+  }
+  if (captureServerStarted)
+  {
+    captureService();
+  }
+}
+
+void bridgeMetrics(JsonDocument &doc)
+{ // filled under the bridge lock, a consistent snapshot; the caller serializes it without the lock
+  const char *dirs[] = {"zbToNet", "netToZb"};
+  bridgeLock();
+  for (uint8_t i = 0; i < 2; i++)
+  {
+    JsonObject dir = doc.createNestedObject(dirs[i]);
+    dir["bytes"] = BridgeStats.dir[i].bytes;
+    dir["frames"] = BridgeStats.dir[i].frames;
+  }
+  doc["uartOverruns"] = BridgeStats.uartOverruns;
+  doc["uartErrors"] = BridgeStats.uartErrors;
+  doc["truncations"] = BridgeStats.truncations;
+  doc["writeStalls"] = BridgeStats.writeStalls;
+  doc["connects"] = BridgeStats.connects;
+  doc["reconnects"] = BridgeStats.reconnects;
+  doc["writeTimeouts"] = BridgeStats.writeTimeouts;
+  doc["rejected"] = BridgeStats.rejected;
+  doc["capturePackets"] = BridgeStats.capturePackets;
+  doc["captureDrops"] = BridgeStats.captureDrops;
+  JsonObject hold = doc.createNestedObject("holdDown");
+  hold["held"] = BridgeStats.holdFrames;
+  hold["replayed"] = BridgeStats.holdReplayed;
+  hold["expired"] = BridgeStats.holdExpired;
+  hold["dropped"] = BridgeStats.holdDropped;
+  if (bridgeTlsHandle)
+  {
+    JsonObject tls = doc.createNestedObject("tls");
+    tls["full"] = TlsStats.full;
+    tls["resumed"] = TlsStats.resumed;
+    tls["failed"] = TlsStats.failed;
+    tls["fullAvgMs"] = TlsStats.full ? TlsStats.fullMs / TlsStats.full : 0;
+    tls["resumedAvgMs"] = TlsStats.resumed ? TlsStats.resumedMs / TlsStats.resumed : 0;
+    tls["lastFullMs"] = TlsStats.lastFullMs;
+    tls["lastResumedMs"] = TlsStats.lastResumedMs;
+    tls["sessions"] = tlsCount();
+  }
+  doc["badFcs"] = MtParser.badFcs;
+  doc["resyncs"] = MtParser.resyncs;
+  JsonArray hist = doc.createNestedArray("latencyUs");
+  for (uint8_t i = 0; i < BRIDGE_LATENCY_BUCKETS; i++)
+  { // {"le": upper bound in us, 0 = open ended, "n": samples}
+    JsonObject bucket = hist.createNestedObject();
+    bucket["le"] = i < BRIDGE_LATENCY_BUCKETS - 1 ? BRIDGE_LATENCY_BOUNDS_US[i] : 0;
+    bucket["n"] = BridgeStats.latencyHist[i];
+  }
+  bridgeUnlock();
+}
+
+void bridgeTask(void *param)
+{
+  for (;;)
+  { // woken by bridgeUartRx() or bridgeWatchTask(), BRIDGE_IDLE_MS at the latest for accept()
+    ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(BRIDGE_IDLE_MS));
+    if (ConfigSettings.bridgeMode == BRIDGE_MODE_TASK && bridgeServerStarted)
+    {
+      bridgeLock();
+      bridgeService();
+      bridgeUnlock();
+    }
+    if (bridgeWatchHandle)
+    {
+      xTaskNotifyGive(bridgeWatchHandle); // sockets drained, watch again
+    }
+  }
+}
+
+void bridgeWatchTask(void *param)
+{ // blocks until a socket is readable (or writable with queued data) and wakes the bridge task
+  for (;;)
+  {
+    fd_set readSet;
+    fd_set writeSet;
+    int maxFd = -1;
+    FD_ZERO(&readSet);
+    FD_ZERO(&writeSet);
+    if (ConfigSettings.bridgeMode == BRIDGE_MODE_TASK)
+    {
+      for (uint8_t i = 0; i < MAX_SOCKET_CLIENTS; i++)
+      {
+        const int fd = clientFd[i];
+        if (fd >= 0)
+        {
+          FD_SET(fd, &readSet);
+          if (clientTxWait[i])
+            FD_SET(fd, &writeSet);
+          maxFd = max(maxFd, fd);
+        }
+      }
+    }
+    if (maxFd < 0)
+    {
+      vTaskDelay(pdMS_TO_TICKS(BRIDGE_IDLE_MS));
+      continue;
+    }
+    ulTaskNotifyTake(pdTRUE, 0); // drop stale "drained" notifications
+    struct timeval timeout = {0, BRIDGE_IDLE_MS * 1000};
+    const int ready = select(maxFd + 1, &readSet, &writeSet, NULL, &timeout);
+    if (ready > 0)
+    {
+      xTaskNotifyGive(bridgeTaskHandle);
+      ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(BRIDGE_IDLE_MS));
+    }
+    else if (ready < 0)
+    { // fd closed under us, the bridge task refreshes clientFd[]
+      vTaskDelay(pdMS_TO_TICKS(BRIDGE_IDLE_MS));
+    }
+  }
+}
+
+void bridgeInit()
+{
+  bridgeMutex = xSemaphoreCreateMutex();
+  bridgeCoreInit();
+  for (byte cln = MAX_SOCKET_CLIENTS; cln > 0; cln--)
+  {
+    slotFree[slotFreeCount++] = cln - 1; // slot 0 is handed out first
+  }
+  logQueue = xQueueCreate(BRIDGE_LOG_QUEUE_BUFS, sizeof(BridgeBuf *));
+  esp_timer_create_args_t batchTimerArgs = {};
+  batchTimerArgs.callback = batchTimerFired;
+  batchTimerArgs.name = "bridgeBatch";
+  esp_timer_create(&batchTimerArgs, &batchTimer);
+  Serial2.onReceive(bridgeUartRx);
+  Serial2.onReceiveError(bridgeUartError);
+  xTaskCreate(bridgeTask, "bridge", BRIDGE_TASK_STACK, NULL, BRIDGE_TASK_PRIORITY, &bridgeTaskHandle);
+  xTaskCreate(bridgeWatchTask, "bridgeWatch", 2048, NULL, BRIDGE_TASK_PRIORITY, &bridgeWatchHandle);
+}
+
+void bridgeServerBegin()
+{
+  bridgeLock();
+  server.begin(ConfigSettings.socketPort);
+  server.setNoDelay(true); // batching is done by the coalescing policy with a bounded delay, not by Nagle
+  if (ConfigSettings.monitorPort > 0 && ConfigSettings.monitorPort != ConfigSettings.socketPort)
+  {
+    monitorServer.begin(ConfigSettings.monitorPort);
+    monitorServer.setNoDelay(true);
+    monitorServerStarted = true;
+  }
+  if (ConfigSettings.capturePort > 0 && ConfigSettings.capturePort != ConfigSettings.socketPort && ConfigSettings.capturePort != ConfigSettings.monitorPort)
+  {
+    captureServer.begin(ConfigSettings.capturePort);
+    captureServer.setNoDelay(true);
+    captureServerStarted = true;
+  }
+  if (ConfigSettings.tlsPort > 0 && ConfigSettings.tlsPort != ConfigSettings.socketPort && ConfigSettings.tlsPort != ConfigSettings.monitorPort &&
+      ConfigSettings.tlsPort != ConfigSettings.capturePort && !bridgeTlsHandle)
+  {
+    tlsServer.begin(ConfigSettings.tlsPort);
+    tlsServer.setNoDelay(true);
+    xTaskCreate(bridgeTlsTask, "bridgeTls", BRIDGE_TLS_TASK_STACK, NULL, WEB_TASK_PRIORITY, &bridgeTlsHandle);
+  }
+  bridgeServerStarted = true;
+  bridgeUnlock();
+}
+
+void bridgeLoop()
+{
+  BridgeBuf *buf;
+  while (logQueue && xQueueReceive(logQueue, &buf, 0) == pdTRUE)
+  { // hex dump outside the bridge task
+    printSocketTraffic(buf);
+    bufRelease(buf);
+  }
+  if (ConfigSettings.coordinator_mode == COORDINATOR_MODE_USB)
+    return;
+  if (ConfigSettings.bridgeMode == BRIDGE_MODE_LOOP && bridgeServerStarted)
+  {
+    bridgeLock();
+    bridgeService();
+    bridgeUnlock();
+  }
+  if (socketStateChanged)
+  { // published from loop(), PubSubClient is not thread safe
+    socketStateChanged = false;
+    mqttPublishIo("socket", ConfigSettings.connectedClients > 0 ? "ON" : "OFF");
+  }
+}
@@ -0,0 +1,12 @@
+#include <ArduinoJson.h>
+
+void bridgeInit();
+void bridgeLoop();
+void bridgeServerBegin();
+void bridgeLock();
+void bridgeUnlock();
+void bridgeStatsReset();
+size_t bridgeClientPending(uint8_t cln);
+uint8_t bridgePoolFree();
+uint8_t bridgeClientRole(uint8_t cln);
+void bridgeMetrics(JsonDocument &doc);
@@ -0,0 +1,842 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <algorithm>
+
+#ifdef ARDUINO
+#include <Arduino.h>
+#include <lwip/sockets.h>
+portMUX_TYPE bufPoolMux = portMUX_INITIALIZER_UNLOCKED; // refs are dropped from the bridge and from loop()
+#define POOL_LOCK() portENTER_CRITICAL(&bufPoolMux)
+#define POOL_UNLOCK() portEXIT_CRITICAL(&bufPoolMux)
+#else
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <mutex>
+std::mutex bufPoolMux;
+#define POOL_LOCK() bufPoolMux.lock()
+#define POOL_UNLOCK() bufPoolMux.unlock()
+#endif
+
+#include "bridge_core.h"
+#include "mt.h"
+#include "pcapng.h"
+#include "recorder.h"
+
+BridgeStatsStruct BridgeStats;
+BridgeCoreSettingsStruct BridgeCoreSettings = {BRIDGE_COALESCE_IMMEDIATE, 2000, 256, 5, 2, 3, 5000, 0};
+MtParserStruct MtParser;
+MtCounterStruct frameCounter[2]; // per BRIDGE_DIR_t
+MtParserStruct frameParser[2];   // per BRIDGE_DIR_t, cuts frames for the recorder and the capture regardless of the coalescing policy
+RecorderStruct FlightRecorder;
+
+ClientQueue txQueue[MAX_SOCKET_CLIENTS]; // UART -> each client
+volatile int clientFd[MAX_SOCKET_CLIENTS] = {-1, -1, -1, -1, -1}; // -1 = free slot
+volatile bool clientTxWait[MAX_SOCKET_CLIENTS];                   // socket buffer full, watch for writability
+CLIENT_ROLE_t clientRole[MAX_SOCKET_CLIENTS];
+uint32_t clientTxSince[MAX_SOCKET_CLIENTS];                       // bridgeMillis() of the last send progress with data queued
+
+BridgeBuf bufPool[BRIDGE_POOL_BUFS];
+BridgeBuf *bufFree[BRIDGE_POOL_BUFS];
+uint8_t bufFreeCount = 0;
+
+int captureFd = -1;
+uint8_t captureRing[BRIDGE_CAPTURE_RING];
+uint32_t captureHead = 0; // free running
+uint32_t captureTail = 0; // free running
+
+BridgeAllowRangeStruct allowRange[BRIDGE_ALLOW_MAX];
+uint8_t allowCount = 0;
+
+uint8_t holdRing[BRIDGE_HOLD_BYTES]; // record: u32 bridgeMillis(), the frame
+uint32_t holdHead = 0; // free running
+uint32_t holdTail = 0; // free running, start of the oldest record
+
+BridgeBuf *batchOut = NULL; // BRIDGE_COALESCE_BATCH: burst being collected
+uint32_t batchSince = 0;    // bridgeMicros() of its first byte
+uint32_t uartLastByteTime = 0;
+
+struct
+{ // SYS_PING benchmark, one request in flight, interleaved with the primary client's SREQs
+  bool active;
+  bool pending;      // our SREQ is out until its SRSP or timeout + grace, the primary client is held off meanwhile
+  uint16_t count;
+  uint16_t sent;
+  uint16_t answered;
+  uint16_t timeoutMs;
+  uint32_t sentAt;   // bridgeMicros()
+  uint32_t *rttUs;   // count samples, from bridgePingStart() until bridgePingResult()
+} pingBench;
+bool clientSreqPending = false; // the coordinator owes the primary client an SRSP
+uint32_t clientSreqAt = 0;
+const uint8_t MT_SYS_PING[] = {MT_SOF, 0x00, 0x21, 0x01, 0x20};
+
+BridgeBuf *bufAlloc(const char *dir)
+{
+  BridgeBuf *buf = NULL;
+  POOL_LOCK();
+  if (bufFreeCount > 0)
+  {
+    buf = bufFree[--bufFreeCount];
+    buf->refs = 1;
+  }
+  POOL_UNLOCK();
+  if (buf)
+  {
+    buf->len = 0;
+    buf->time = bridgeMillis();
+    buf->dir = dir;
+  }
+  else
+  {
+    BridgeStats.poolExhausted++;
+  }
+  return buf;
+}
+
+void bufRef(BridgeBuf *buf)
+{
+  POOL_LOCK();
+  buf->refs++;
+  POOL_UNLOCK();
+}
+
+void bufRelease(BridgeBuf *buf)
+{
+  POOL_LOCK();
+  if (--buf->refs == 0)
+  {
+    bufFree[bufFreeCount++] = buf;
+  }
+  POOL_UNLOCK();
+}
+
+bool ClientQueue::push(BridgeBuf *buf)
+{
+  if (count() == BRIDGE_CLIENT_QUEUE_BUFS)
+    return false;
+  bufRef(buf);
+  slot[head++ & (BRIDGE_CLIENT_QUEUE_BUFS - 1)] = buf;
+  bytes += buf->len;
+  return true;
+}
+
+void ClientQueue::consume(size_t len)
+{
+  BridgeBuf *buf = front();
+  offset += len;
+  bytes -= len;
+  if (offset >= buf->len)
+  {
+    offset = 0;
+    tail++;
+    bufRelease(buf);
+  }
+}
+
+void ClientQueue::clear()
+{
+  while (count())
+  {
+    bufRelease(slot[tail++ & (BRIDGE_CLIENT_QUEUE_BUFS - 1)]);
+  }
+  offset = 0;
+  bytes = 0;
+}
+
+void bridgeCoreInit()
+{
+  mtParserReset(MtParser);
+  bridgeCoreStatsReset();
+  memset(frameCounter, 0, sizeof(frameCounter));
+  mtParserReset(frameParser[BRIDGE_DIR_ZB_TO_NET]);
+  mtParserReset(frameParser[BRIDGE_DIR_NET_TO_ZB]);
+  recorderReset(FlightRecorder);
+  holdHead = 0;
+  holdTail = 0;
+  pingBench.active = false;
+  pingBench.pending = false;
+  clientSreqPending = false;
+  batchOut = NULL;
+  bufFreeCount = 0;
+  for (uint8_t i = 0; i < BRIDGE_POOL_BUFS; i++)
+  {
+    bufFree[bufFreeCount++] = &bufPool[i];
+  }
+}
+
+void bridgeCoreStatsReset()
+{
+  memset(&BridgeStats, 0, sizeof(BridgeStats));
+  MtParser.frames = 0;
+  MtParser.badFcs = 0;
+  MtParser.resyncs = 0;
+}
+
+size_t bridgeClientPending(uint8_t cln)
+{
+  return txQueue[cln].bytes;
+}
+
+uint8_t bridgeClientRole(uint8_t cln)
+{
+  return clientRole[cln];
+}
+
+uint8_t bridgePoolFree()
+{
+  return bufFreeCount;
+}
+
+uint8_t bridgeAllowSet(const char *list)
+{ // "192.168.1.0/24, 10.0.0.7" -> masks compared on accept; malformed entries and those past
+  // BRIDGE_ALLOW_MAX go to bridgeAllowRejected(), returns the ranges kept
+  uint8_t count = 0;
+  while (list && *list)
+  {
+    const size_t skip = strspn(list, " ,;");
+    list += skip;
+    const size_t len = strcspn(list, " ,;");
+    if (len == 0)
+      break;
+    char entry[20];
+    memcpy(entry, list, std::min(len, sizeof(entry) - 1));
+    entry[std::min(len, sizeof(entry) - 1)] = 0;
+    list += len;
+    unsigned int a, b, c, d, bits = 32;
+    char tail;
+    bool valid = len < sizeof(entry) && count < BRIDGE_ALLOW_MAX;
+    if (valid && sscanf(entry, "%u.%u.%u.%u%c", &a, &b, &c, &d, &tail) != 4) // a host, nothing after it
+      valid = sscanf(entry, "%u.%u.%u.%u/%u%c", &a, &b, &c, &d, &bits, &tail) == 5; // or a range
+    if (!valid || a > 255 || b > 255 || c > 255 || d > 255 || bits > 32)
+    {
+      bridgeAllowRejected(entry);
+      continue;
+    }
+    const uint32_t mask = bits ? 0xFFFFFFFFUL << (32 - bits) : 0;
+    allowRange[count].mask = mask;
+    allowRange[count].net = ((a << 24) | (b << 16) | (c << 8) | d) & mask;
+    count++;
+  }
+  allowCount = count;
+  return count;
+}
+
+bool bridgeAllowMatch(uint32_t ip)
+{
+  for (uint8_t i = 0; i < allowCount; i++)
+  {
+    if ((ip & allowRange[i].mask) == allowRange[i].net)
+      return true;
+  }
+  return false;
+}
+
+void captureWrite(const uint8_t *data, size_t len)
+{
+  for (size_t i = 0; i < len; i++)
+  {
+    captureRing[captureHead++ & (BRIDGE_CAPTURE_RING - 1)] = data[i];
+  }
+}
+
+void bridgeCaptureStart(int fd)
+{ // a new capture starts with its own section header
+  uint8_t header[PCAPNG_HEADER_LEN];
+  captureHead = captureTail = 0;
+  captureWrite(header, pcapngHeader(header));
+  captureFd = fd;
+}
+
+void bridgeCaptureStop()
+{
+  captureFd = -1;
+}
+
+void captureFrame(BRIDGE_DIR_t dir, uint64_t timeUs, const uint8_t *frame, uint16_t len)
+{
+  uint8_t block[MT_FRAME_MAX + PCAPNG_PACKET_OVERHEAD];
+  if (BRIDGE_CAPTURE_RING - (captureHead - captureTail) < sizeof(block))
+  {
+    BridgeStats.captureDrops++;
+    return;
+  }
+  const PCAPNG_DIR_t pcapDir = dir == BRIDGE_DIR_ZB_TO_NET ? PCAPNG_DIR_INBOUND : PCAPNG_DIR_OUTBOUND;
+  captureWrite(block, pcapngPacket(block, timeUs, pcapDir, frame, len));
+  BridgeStats.capturePackets++;
+}
+
+bool primaryAttached()
+{
+  for (uint8_t cln = 0; cln < MAX_SOCKET_CLIENTS; cln++)
+  {
+    if (clientFd[cln] >= 0 && clientRole[cln] == CLIENT_ROLE_PRIMARY)
+      return true;
+  }
+  return false;
+}
+
+void holdCopy(uint8_t *out, uint32_t at, size_t len)
+{ // out of the ring, at most two memcpy
+  at &= BRIDGE_HOLD_BYTES - 1;
+  const size_t first = std::min<size_t>(len, BRIDGE_HOLD_BYTES - at);
+  memcpy(out, holdRing + at, first);
+  memcpy(out + first, holdRing, len - first);
+}
+
+void holdPut(const void *data, size_t len)
+{
+  const uint32_t at = holdHead & (BRIDGE_HOLD_BYTES - 1);
+  const size_t first = std::min<size_t>(len, BRIDGE_HOLD_BYTES - at);
+  memcpy(holdRing + at, data, first);
+  memcpy(holdRing, (const uint8_t *)data + first, len - first);
+  holdHead += len;
+}
+
+uint16_t holdFrameLen(uint32_t at)
+{ // the MT length byte follows the time stamp and the SOF
+  return holdRing[(at + sizeof(uint32_t) + 1) & (BRIDGE_HOLD_BYTES - 1)] + MT_HEADER_LEN + 1;
+}
+
+void holdExpire(uint32_t now)
+{ // TTL, oldest first
+  while (holdTail != holdHead)
+  {
+    uint32_t time;
+    holdCopy((uint8_t *)&time, holdTail, sizeof(time));
+    if (now - time <= BridgeCoreSettings.holdMs)
+      break;
+    holdTail += sizeof(time) + holdFrameLen(holdTail);
+    BridgeStats.holdExpired++;
+  }
+}
+
+void holdAdd(uint32_t timeMs, const uint8_t *frame, uint16_t len)
+{ // a full ring makes room by dropping the oldest frames
+  const uint16_t need = sizeof(timeMs) + len;
+  holdExpire(timeMs);
+  while (BRIDGE_HOLD_BYTES - (holdHead - holdTail) < need)
+  {
+    holdTail += sizeof(uint32_t) + holdFrameLen(holdTail);
+    BridgeStats.holdDropped++;
+  }
+  holdPut(&timeMs, sizeof(timeMs));
+  holdPut(frame, len);
+  BridgeStats.holdFrames++;
+}
+
+void framesFeed(BRIDGE_DIR_t dir, const uint8_t *buf, size_t len)
+{ // one timestamp per burst, that is when the bridge saw it
+  const uint32_t timeMs = bridgeMillis();
+  const uint64_t timeUs = captureFd >= 0 ? bridgeTimeUs() : 0;
+  for (size_t i = 0; i < len; i++)
+  {
+    const uint16_t frameLen = mtParserFeed(frameParser[dir], buf[i]);
+    if (frameLen == 0)
+      continue;
+    const uint8_t type = mtType(frameParser[dir].frame);
+    if (dir == BRIDGE_DIR_NET_TO_ZB && type == MT_TYPE_SREQ)
+    { // while a benchmark SREQ is out the client is held off, an SREQ then is the benchmark's own
+      if (!pingBench.pending)
+      {
+        clientSreqPending = true;
+        clientSreqAt = timeMs;
+      }
+    }
+    else if (dir == BRIDGE_DIR_ZB_TO_NET && type == MT_TYPE_SRSP)
+    {
+      if (!pingBench.pending)
+        clientSreqPending = false;
+    }
+    else if (dir == BRIDGE_DIR_ZB_TO_NET && type == MT_TYPE_AREQ && BridgeCoreSettings.holdMs > 0 && !primaryAttached())
+    { // an SRSP answers a request of the client that left, only AREQs (joins, reports) are worth keeping
+      holdAdd(timeMs, frameParser[dir].frame, frameLen);
+    }
+    recorderAdd(FlightRecorder, timeMs, dir, frameParser[dir].frame, frameLen);
+    if (captureFd >= 0)
+      captureFrame(dir, timeUs, frameParser[dir].frame, frameLen);
+  }
+}
+
+bool bridgeCaptureDrain()
+{ // false once the capture client is gone
+  uint8_t sink[16];
+  const int got = recv(captureFd, sink, sizeof(sink), MSG_DONTWAIT);
+  if (got == 0 || (got < 0 && errno != EAGAIN && errno != EWOULDBLOCK))
+    return false;
+  while (captureHead != captureTail)
+  {
+    const uint32_t at = captureTail & (BRIDGE_CAPTURE_RING - 1);
+    const size_t len = std::min<size_t>(captureHead - captureTail, BRIDGE_CAPTURE_RING - at);
+    const int sent = send(captureFd, captureRing + at, len, MSG_DONTWAIT);
+    if (sent < 0)
+      return errno == EAGAIN || errno == EWOULDBLOCK;
+    captureTail += sent;
+    if ((size_t)sent < len)
+      break;
+  }
+  return true;
+}
+
+void bridgeCount(BRIDGE_DIR_t dir, const uint8_t *buf, size_t len)
+{
+  BridgeStats.dir[dir].bytes += len;
+  BridgeStats.dir[dir].frames += mtCountFrames(frameCounter[dir], buf, len);
+  framesFeed(dir, buf, len);
+}
+
+void bridgeCoreKeepAlive(int fd)
+{ // a peer that vanished without a FIN is noticed after keepIdle + keepIntvl * keepCount seconds
+  int on = BridgeCoreSettings.keepIdle > 0;
+  setsockopt(fd, SOL_SOCKET, SO_KEEPALIVE, &on, sizeof(on));
+  if (!on)
+    return;
+  int idle = BridgeCoreSettings.keepIdle;
+  int intvl = BridgeCoreSettings.keepIntvl;
+  int count = BridgeCoreSettings.keepCount;
+  setsockopt(fd, IPPROTO_TCP, TCP_KEEPIDLE, &idle, sizeof(idle));
+  setsockopt(fd, IPPROTO_TCP, TCP_KEEPINTVL, &intvl, sizeof(intvl));
+  setsockopt(fd, IPPROTO_TCP, TCP_KEEPCNT, &count, sizeof(count));
+}
+
+void bridgeCoreClientReset(uint8_t cln)
+{ // free the slot right away, queued data is discarded
+  txQueue[cln].clear();
+  clientTxWait[cln] = false;
+  clientFd[cln] = -1;
+}
+
+bool recvFailed(int got)
+{ // 0 is an orderly shutdown by the peer
+  return got == 0 || (got < 0 && errno != EAGAIN && errno != EWOULDBLOCK);
+}
+
+size_t clientToSerial(uint8_t cln)
+{ // forward everything the socket has to the UART, one pooled buffer at a time
+  size_t total = 0;
+  for (;;)
+  {
+    BridgeBuf *buf = bufAlloc("->");
+    if (!buf)
+      break; // the rest stays in the receive window
+    const int got = bridgeClientRecv(cln, buf->data, sizeof(buf->data));
+    if (got > 0)
+    {
+      buf->len = got;
+      if ((size_t)got == sizeof(buf->data))
+        BridgeStats.truncations++; // possibly more behind it
+      bridgeCount(BRIDGE_DIR_NET_TO_ZB, buf->data, buf->len);
+      bridgeUartWrite(buf->data, buf->len);
+      bridgeBufLog(buf);
+      total += got;
+    }
+    bufRelease(buf);
+    if (recvFailed(got))
+    {
+      bridgeClientLost(cln, false);
+      break;
+    }
+    if (got < (int)sizeof(buf->data))
+      break;
+  }
+  return total;
+}
+
+void clientDiscard(uint8_t cln)
+{ // monitors are read only, keep their socket drained without touching the UART
+  uint8_t sink[64];
+  for (;;)
+  {
+    const int got = bridgeClientRecv(cln, sink, sizeof(sink));
+    if (got > 0)
+    {
+      BridgeStats.client[cln].rxDropped += got;
+      continue;
+    }
+    if (recvFailed(got))
+      bridgeClientLost(cln, false);
+    break;
+  }
+}
+
+void clientEvict(uint8_t cln, size_t len)
+{
+  BridgeClientStatsStruct &stats = BridgeStats.client[cln];
+  stats.drops += txQueue[cln].bytes + len;
+  stats.evictions++;
+  bridgeClientLost(cln, true);
+}
+
+void clientDrain(uint8_t cln)
+{ // send as much of the queue as the socket takes without blocking
+  BridgeBuf *buf;
+  while ((buf = txQueue[cln].front()) != NULL)
+  {
+    const size_t len = buf->len - txQueue[cln].offset;
+    const int sent = bridgeClientSend(cln, buf->data + txQueue[cln].offset, len);
+    if (sent < 0)
+    {
+      if (errno == EAGAIN || errno == EWOULDBLOCK)
+      {
+        BridgeStats.client[cln].stalls++;
+        BridgeStats.writeStalls++;
+        break;
+      }
+      bridgeClientLost(cln, false); // connection reset or similar
+      return;
+    }
+    if (sent > 0)
+      clientTxSince[cln] = bridgeMillis();
+    txQueue[cln].consume(sent);
+    if ((size_t)sent < len)
+    {
+      BridgeStats.client[cln].stalls++;
+      BridgeStats.writeStalls++;
+      break;
+    }
+  }
+  clientTxWait[cln] = txQueue[cln].count() > 0;
+  if (clientTxWait[cln] && BridgeCoreSettings.writeDeadlineMs > 0 &&
+      bridgeMillis() - clientTxSince[cln] > BridgeCoreSettings.writeDeadlineMs)
+  { // peer stopped reading or is gone, don't wait for the queue to overflow
+    BridgeStats.client[cln].timeouts++;
+    BridgeStats.writeTimeouts++;
+    bridgeClientLost(cln, false);
+  }
+}
+
+void bufFanOut(BridgeBuf *buf)
+{ // queue a reference for every client and the log recorder, then drop ours
+  for (uint8_t cln = 0; cln < MAX_SOCKET_CLIENTS; cln++)
+  {
+    if (clientFd[cln] < 0)
+      continue;
+    if (txQueue[cln].count() == BRIDGE_CLIENT_QUEUE_BUFS)
+      clientDrain(cln); // long read burst, make room before giving up on it
+    if (clientFd[cln] < 0)
+      continue;
+    if (txQueue[cln].count() == 0)
+      clientTxSince[cln] = bridgeMillis(); // deadline runs from the first queued byte
+    if (!txQueue[cln].push(buf))
+    { // too slow or dead, don't let it hold up the others
+      clientEvict(cln, buf->len);
+      continue;
+    }
+    BridgeStats.client[cln].queued += buf->len;
+  }
+  bridgeBufLog(buf);
+  bufRelease(buf);
+}
+
+void serialBytesToClients()
+{ // forward bursts as they come out of the uart
+  int avail;
+  while ((avail = bridgeUartAvailable()) > 0)
+  {
+    BridgeBuf *buf = bufAlloc("<-");
+    if (!buf)
+      break; // the rest stays in the uart driver buffer
+    if ((size_t)avail > sizeof(buf->data))
+      BridgeStats.truncations++;
+    buf->len = bridgeUartRead(buf->data, std::min((size_t)avail, sizeof(buf->data)));
+    if (buf->len == 0)
+    {
+      bufRelease(buf);
+      break;
+    }
+    bridgeCount(BRIDGE_DIR_ZB_TO_NET, buf->data, buf->len);
+    bufFanOut(buf);
+  }
+}
+
+void serialFramesToClients()
+{ // forward complete MT frames only, as many as fit into one buffer per TCP write
+  uint8_t raw[64];
+  BridgeBuf *out = NULL;
+  int avail;
+  while ((avail = bridgeUartAvailable()) > 0 && bridgePoolFree() > 1)
+  {
+    const size_t got = bridgeUartRead(raw, std::min((size_t)avail, sizeof(raw)));
+    if (got == 0)
+      break;
+    bridgeCount(BRIDGE_DIR_ZB_TO_NET, raw, got);
+    uartLastByteTime = bridgeMillis();
+    for (size_t i = 0; i < got; i++)
+    {
+      const uint16_t len = mtParserFeed(MtParser, raw[i]);
+      if (len == 0)
+        continue;
+      if (pingBench.pending && mtType(MtParser.frame) == MT_TYPE_SRSP && (MtParser.frame[2] & 0x1F) == (MT_SYS_PING[2] & 0x1F) && MtParser.frame[3] == MT_SYS_PING[3])
+      { // ours, the clients never asked for it; past the timeout it was counted as lost
+        const uint32_t rttUs = bridgeMicros() - pingBench.sentAt;
+        if (pingBench.active && rttUs < (uint32_t)pingBench.timeoutMs * 1000)
+          pingBench.rttUs[pingBench.answered++] = rttUs;
+        pingBench.pending = false;
+        continue;
+      }
+      if (out && out->len + len > sizeof(out->data))
+      {
+        bufFanOut(out);
+        out = NULL;
+      }
+      if (!out && !(out = bufAlloc("<-")))
+        continue; // frame lost, counted as pool exhaustion
+      memcpy(out->data + out->len, MtParser.frame, len);
+      out->len += len;
+    }
+  }
+  if (out)
+  {
+    bufFanOut(out);
+  }
+}
+
+void batchFlush()
+{
+  if (!batchOut)
+    return;
+  if (batchOut->len > 0)
+    bufFanOut(batchOut);
+  else
+    bufRelease(batchOut);
+  batchOut = NULL;
+}
+
+BRIDGE_COALESCE_t coalescePolicy()
+{ // benchmark answers are cut out of the stream
+  return pingBench.active || pingBench.pending ? BRIDGE_COALESCE_FRAME : BridgeCoreSettings.coalesce;
+}
+
+void holdQueue(uint8_t cln, BridgeBuf *buf)
+{ // replay goes to the new primary only, ahead of live data
+  if (txQueue[cln].count() == 0)
+    clientTxSince[cln] = bridgeMillis();
+  if (txQueue[cln].push(buf))
+    BridgeStats.client[cln].queued += buf->len;
+  bufRelease(buf);
+}
+
+void holdReplay(uint8_t cln)
+{ // held frames, then the head of a frame in progress, so the stream starts on a frame boundary
+  holdExpire(bridgeMillis());
+  BridgeBuf *out = NULL;
+  while (holdTail != holdHead)
+  {
+    const uint16_t len = holdFrameLen(holdTail);
+    if (out && out->len + len > sizeof(out->data))
+    {
+      holdQueue(cln, out);
+      out = NULL;
+    }
+    if (!out && (bridgePoolFree() <= BRIDGE_POOL_BUFS / 2 || !(out = bufAlloc("<-"))))
+      break; // live traffic keeps its buffers
+    holdCopy(out->data + out->len, holdTail + sizeof(uint32_t), len);
+    out->len += len;
+    holdTail += sizeof(uint32_t) + len;
+    BridgeStats.holdReplayed++;
+  }
+  while (holdTail != holdHead)
+  {
+    holdTail += sizeof(uint32_t) + holdFrameLen(holdTail);
+    BridgeStats.holdDropped++;
+  }
+  const MtParserStruct &partial = frameParser[BRIDGE_DIR_ZB_TO_NET];
+  if (coalescePolicy() != BRIDGE_COALESCE_FRAME && partial.pos > 0)
+  { // its first bytes went out before the client was there, the rest follows live
+    if (out && out->len + partial.pos > sizeof(out->data))
+    {
+      holdQueue(cln, out);
+      out = NULL;
+    }
+    if (out || (out = bufAlloc("<-")))
+    {
+      memcpy(out->data + out->len, partial.frame, partial.pos);
+      out->len += partial.pos;
+    }
+  }
+  if (out)
+    holdQueue(cln, out);
+}
+
+void bridgeCoreClientOpen(uint8_t cln, int fd, CLIENT_ROLE_t role)
+{
+  bridgeCoreKeepAlive(fd);
+  if (role == CLIENT_ROLE_PRIMARY && BridgeCoreSettings.holdMs > 0)
+    batchFlush(); // bytes collected so far belong to the clients that were there
+  txQueue[cln].clear();
+  clientTxWait[cln] = false;
+  clientRole[cln] = role;
+  clientFd[cln] = fd;
+  if (role == CLIENT_ROLE_PRIMARY && BridgeCoreSettings.holdMs > 0)
+    holdReplay(cln);
+}
+
+void batchCheck()
+{ // flush when due, otherwise wake up again when it will be
+  if (!batchOut)
+    return;
+  const uint32_t age = bridgeMicros() - batchSince;
+  if (age >= BridgeCoreSettings.coalesceUs || batchOut->len >= BridgeCoreSettings.coalesceBytes)
+  {
+    batchFlush();
+    return;
+  }
+  bridgeTimerArm(BridgeCoreSettings.coalesceUs - age);
+}
+
+void serialBatchToClients()
+{ // collect until coalesceBytes are in or coalesceUs have passed since the first byte
+  int avail;
+  while ((avail = bridgeUartAvailable()) > 0)
+  {
+    if (batchOut && batchOut->len >= BridgeCoreSettings.coalesceBytes)
+      batchFlush();
+    if (!batchOut)
+    {
+      if (!(batchOut = bufAlloc("<-")))
+        break; // the rest stays in the uart driver buffer
+      batchSince = bridgeMicros();
+    }
+    const size_t room = BridgeCoreSettings.coalesceBytes - batchOut->len;
+    const size_t got = bridgeUartRead(batchOut->data + batchOut->len, std::min((size_t)avail, room));
+    if (got == 0)
+      break;
+    bridgeCount(BRIDGE_DIR_ZB_TO_NET, batchOut->data + batchOut->len, got);
+    batchOut->len += got;
+  }
+  batchCheck();
+}
+
+void clientsDrain()
+{
+  for (uint8_t cln = 0; cln < MAX_SOCKET_CLIENTS; cln++)
+  {
+    if (clientFd[cln] >= 0 && txQueue[cln].count() > 0)
+      clientDrain(cln);
+  }
+}
+
+void serialToClients()
+{ // read according to the coalescing policy, then drain what the sockets take
+  const BRIDGE_COALESCE_t policy = coalescePolicy();
+  if (policy != BRIDGE_COALESCE_BATCH)
+    batchFlush(); // policy changed with a batch pending
+  if (policy != BRIDGE_COALESCE_FRAME && mtParserBusy(MtParser))
+    mtParserReset(MtParser); // policy changed mid frame
+
+  if (policy == BRIDGE_COALESCE_FRAME)
+    serialFramesToClients();
+  else if (policy == BRIDGE_COALESCE_BATCH)
+    serialBatchToClients();
+  else
+    serialBytesToClients();
+  clientsDrain();
+}
+
+bool bridgePingStart(uint16_t count, uint16_t timeoutMs)
+{ // false while a run is going on or the last ping of the previous one is still out, or without memory
+  if (pingBench.active || pingBench.pending || count == 0)
+    return false;
+  free(pingBench.rttUs); // a run whose result was never read
+  pingBench.count = std::min(count, BRIDGE_PING_MAX);
+  pingBench.rttUs = (uint32_t *)malloc(pingBench.count * sizeof(uint32_t));
+  if (!pingBench.rttUs)
+    return false;
+  pingBench.timeoutMs = timeoutMs;
+  pingBench.sent = 0;
+  pingBench.answered = 0;
+  pingBench.active = true;
+  return true;
+}
+
+bool bridgePingBusy()
+{
+  return pingBench.active;
+}
+
+void bridgePingStop()
+{ // abandons the run; a ping still out is swallowed or times out as usual
+  pingBench.active = false;
+}
+
+void bridgePingResult(BridgePingResultStruct &res)
+{ // once after the run, sorts the samples in place and frees them
+  memset(&res, 0, sizeof(res));
+  res.sent = pingBench.sent;
+  res.answered = pingBench.answered;
+  uint32_t *rtt = pingBench.rttUs;
+  const uint16_t n = pingBench.answered;
+  if (rtt && n)
+  {
+    std::sort(rtt, rtt + n);
+    res.minUs = rtt[0];
+    res.p50Us = rtt[(n - 1) / 2];
+    res.p99Us = rtt[(n - 1) * 99 / 100];
+    res.maxUs = rtt[n - 1];
+  }
+  free(rtt);
+  pingBench.rttUs = NULL;
+}
+
+void pingStep()
+{ // a ping goes out only between the primary client's SREQ/SRSP exchanges, ZNP allows one SREQ at a time
+  if (pingBench.pending)
+  { // lost after timeoutMs, but the SREQ slot stays ours for the grace time so a late SRSP can't reach the client
+    if (bridgeMicros() - pingBench.sentAt < ((uint32_t)pingBench.timeoutMs + BRIDGE_PING_GRACE_MS) * 1000)
+      return;
+    pingBench.pending = false;
+  }
+  if (!pingBench.active)
+    return;
+  if (pingBench.sent == pingBench.count)
+  {
+    pingBench.active = false;
+    return;
+  }
+  if (clientSreqPending && bridgeMillis() - clientSreqAt < BRIDGE_SREQ_TIMEOUT_MS)
+    return;
+  clientSreqPending = false;
+  pingBench.pending = true; // before bridgeCount(), the SREQ is not taken for the client's
+  bridgeCount(BRIDGE_DIR_NET_TO_ZB, MT_SYS_PING, sizeof(MT_SYS_PING)); // recorded and captured like client traffic
+  pingBench.sentAt = bridgeMicros();
+  bridgeUartWrite(MT_SYS_PING, sizeof(MT_SYS_PING));
+  pingBench.sent++;
+}
+
+bool bridgeCoreService()
+{ // one pass over the open slots and the UART, true if coordinator output was forwarded
+  for (uint8_t cln = 0; cln < MAX_SOCKET_CLIENTS; cln++)
+  {
+    if (clientFd[cln] >= 0 && txQueue[cln].count() > 0)
+      clientDrain(cln); // leftovers of earlier bursts
+    if (clientFd[cln] < 0)
+      continue;
+    if (clientRole[cln] == CLIENT_ROLE_PRIMARY)
+    {
+      if (!pingBench.pending) // held in the socket while a benchmark SREQ is out
+        clientToSerial(cln); // read from LAN, send to Zigbee
+    }
+    else
+      clientDiscard(cln);
+  }
+
+  if (bridgeUartAvailable() > 0)
+  { // read from Zigbee, send to LAN
+    serialToClients();
+    pingStep();
+    return true;
+  }
+  pingStep();
+  if (batchOut)
+  { // woken by the batch timer
+    batchCheck();
+    clientsDrain();
+  }
+  else if (mtParserBusy(MtParser) && bridgeMillis() - uartLastByteTime > BRIDGE_FRAME_TIMEOUT_MS)
+  { // truncated frame, don't let it swallow the next one
+    mtParserReset(MtParser);
+  }
+  return false;
+}
@@ -0,0 +1,193 @@
+#ifndef BRIDGE_CORE_H_
+#define BRIDGE_CORE_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "mt.h"
+#include "recorder.h"
+
+// Serial <-> socket forwarding without Arduino or ESP-IDF dependencies. bridge.cpp binds it to
+// Serial2, WiFiServer and the FreeRTOS tasks; tools/bridge_host binds it to a pty and Linux sockets.
+
+const uint8_t MAX_SOCKET_CLIENTS = 5;
+const uint16_t BRIDGE_BUF_SIZE = 320;      // pooled burst buffer, shared by reference between consumers; holds a full MT frame
+const uint8_t BRIDGE_POOL_BUFS = 48;       // more than a client queue plus the log queue can hold
+const uint8_t BRIDGE_CLIENT_QUEUE_BUFS = 32; // per client tx queue, power of two; overflow evicts the client
+const uint8_t BRIDGE_FRAME_TIMEOUT_MS = 50; // frame aware mode: drop a partial MT frame after this much UART silence
+const uint8_t BRIDGE_ALLOW_MAX = 8;        // CIDR ranges in the connection allow-list
+const uint16_t BRIDGE_CAPTURE_RING = 8192; // pcapng bytes waiting for the capture client, power of two
+const uint16_t BRIDGE_HOLD_BYTES = 4096;   // coordinator AREQs kept while no primary client is attached, power of two
+const uint16_t BRIDGE_PING_MAX = 1000;     // SYS_PING benchmark samples per run
+const uint16_t BRIDGE_SREQ_TIMEOUT_MS = 1000; // a client SREQ without SRSP stops holding off the benchmark after this
+const uint16_t BRIDGE_PING_GRACE_MS = 200;    // a benchmark SYS_PING past its timeout is lost, a late SRSP is still swallowed
+
+enum BRIDGE_DIR_t : uint8_t
+{
+  BRIDGE_DIR_ZB_TO_NET, // coordinator -> socket clients
+  BRIDGE_DIR_NET_TO_ZB  // primary client -> coordinator
+};
+
+const uint32_t BRIDGE_LATENCY_BOUNDS_US[] = {100, 250, 500, 1000, 2500, 5000, 10000, 25000, 50000};
+const uint8_t BRIDGE_LATENCY_BUCKETS = sizeof(BRIDGE_LATENCY_BOUNDS_US) / sizeof(BRIDGE_LATENCY_BOUNDS_US[0]) + 1; // last one is open ended
+
+enum CLIENT_ROLE_t : uint8_t
+{
+  CLIENT_ROLE_PRIMARY, // the one client allowed to write to the coordinator
+  CLIENT_ROLE_MONITOR  // read only, its writes are discarded
+};
+
+enum BRIDGE_COALESCE_t : uint8_t
+{ // how coordinator output is grouped into TCP writes
+  BRIDGE_COALESCE_IMMEDIATE, // every UART read goes out at once
+  BRIDGE_COALESCE_BATCH,     // wait up to coalesceUs or coalesceBytes
+  BRIDGE_COALESCE_FRAME      // whole ZNP/MT frames, flushed at frame boundaries
+};
+
+struct BridgeLatencyStruct
+{ // UART rx event -> TCP write done
+  uint32_t samples;
+  uint32_t minUs;
+  uint32_t maxUs;
+  uint64_t sumUs;
+};
+
+struct BridgeClientStatsStruct
+{ // per socket slot
+  uint32_t queued;    // bytes put into the tx queue
+  uint32_t drops;     // bytes discarded on eviction
+  uint32_t evictions; // disconnects because the tx queue overflowed
+  uint32_t rxDropped; // bytes written by a monitor client, not forwarded
+  uint32_t stalls;    // sends cut short by a full socket buffer
+  uint32_t timeouts;  // disconnects because queued data made no progress within the write deadline
+};
+
+struct BridgeDirStatsStruct
+{
+  uint32_t bytes;
+  uint32_t frames; // ZNP/MT frames by structure, FCS not checked
+};
+
+struct BridgeStatsStruct
+{
+  BridgeLatencyStruct latency[2]; // per BRIDGE_MODE_t
+  BridgeClientStatsStruct client[MAX_SOCKET_CLIENTS];
+  uint32_t poolExhausted; // reads deferred because no buffer was free
+  uint32_t logSkipped;    // bursts not hex dumped, log queue full
+  BridgeDirStatsStruct dir[2]; // per BRIDGE_DIR_t
+  uint32_t uartOverruns;  // uart FIFO or driver buffer overflows, data lost
+  uint32_t uartErrors;    // framing, parity and break errors
+  uint32_t truncations;   // bursts larger than a pooled buffer, split over several writes
+  uint32_t writeStalls;   // sends cut short by a full socket buffer, all clients
+  uint32_t connects;
+  uint32_t reconnects;    // connects from an address that was connected before
+  uint32_t writeTimeouts; // clients dropped by the write deadline, all clients
+  uint32_t rejected;      // connections refused by the allow-list or for lack of a free slot
+  uint32_t capturePackets; // frames written to the capture port
+  uint32_t captureDrops;   // frames not captured, capture client too slow
+  uint32_t holdFrames;     // AREQs held while no primary client was attached
+  uint32_t holdReplayed;   // held frames sent to the next primary client
+  uint32_t holdExpired;    // held frames older than holdMs, not replayed
+  uint32_t holdDropped;    // held frames overwritten by newer ones or without a buffer for the replay
+  uint32_t latencyHist[BRIDGE_LATENCY_BUCKETS];
+};
+
+struct BridgeCoreSettingsStruct
+{ // copied from ConfigSettings by the platform before each pass
+  BRIDGE_COALESCE_t coalesce;
+  uint16_t coalesceUs;
+  uint16_t coalesceBytes;
+  uint16_t keepIdle;        // s without traffic before the first keepalive probe, 0 = keepalive off
+  uint8_t keepIntvl;        // s between probes
+  uint8_t keepCount;        // unanswered probes before the stack drops the connection
+  uint16_t writeDeadlineMs; // queued data not accepted by the socket for this long drops the client, 0 = off
+  uint16_t holdMs;          // hold-down TTL: coordinator frames without a primary client are replayed to the next one, 0 = off
+};
+
+struct BridgePingResultStruct
+{ // SYS_PING benchmark, round trip from the UART write to the parsed SRSP
+  uint16_t sent;
+  uint16_t answered; // the rest timed out
+  uint32_t minUs;
+  uint32_t p50Us;
+  uint32_t p99Us;
+  uint32_t maxUs;
+};
+
+struct BridgeAllowRangeStruct
+{ // host byte order
+  uint32_t net;
+  uint32_t mask;
+};
+
+struct BridgeBuf
+{ // burst read from the UART or a socket, shared by reference between the client queues and the log recorder
+  uint8_t refs;
+  uint16_t len;
+  uint32_t time; // bridgeMillis() at receipt
+  const char *dir;
+  uint8_t data[BRIDGE_BUF_SIZE];
+};
+
+struct ClientQueue
+{ // references to pending bursts of one socket client, runs under the bridge lock
+  BridgeBuf *slot[BRIDGE_CLIENT_QUEUE_BUFS];
+  uint8_t head = 0;    // free running
+  uint8_t tail = 0;    // free running
+  uint16_t offset = 0; // bytes of the front buffer already sent
+  size_t bytes = 0;    // pending bytes
+
+  uint8_t count() const { return head - tail; }
+  BridgeBuf *front() const { return count() ? slot[tail & (BRIDGE_CLIENT_QUEUE_BUFS - 1)] : NULL; }
+  bool push(BridgeBuf *buf);
+  void consume(size_t len);
+  void clear();
+};
+
+extern BridgeStatsStruct BridgeStats;
+extern BridgeCoreSettingsStruct BridgeCoreSettings;
+extern MtParserStruct MtParser;
+extern RecorderStruct FlightRecorder;
+extern ClientQueue txQueue[MAX_SOCKET_CLIENTS];
+extern volatile int clientFd[MAX_SOCKET_CLIENTS];
+extern volatile bool clientTxWait[MAX_SOCKET_CLIENTS];
+extern CLIENT_ROLE_t clientRole[MAX_SOCKET_CLIENTS];
+
+void bridgeCoreInit();
+bool bridgeCoreService();
+void bridgeCoreClientOpen(uint8_t cln, int fd, CLIENT_ROLE_t role);
+void bridgeCoreClientReset(uint8_t cln);
+void bridgeCoreKeepAlive(int fd);
+void bridgeCoreStatsReset();
+void bridgeCount(BRIDGE_DIR_t dir, const uint8_t *buf, size_t len);
+BridgeBuf *bufAlloc(const char *dir);
+void bufRef(BridgeBuf *buf);
+void bufRelease(BridgeBuf *buf);
+size_t bridgeClientPending(uint8_t cln);
+uint8_t bridgeClientRole(uint8_t cln);
+uint8_t bridgePoolFree();
+void bridgeCaptureStart(int fd);
+void bridgeCaptureStop();
+bool bridgeCaptureDrain();
+uint8_t bridgeAllowSet(const char *list);
+bool bridgeAllowMatch(uint32_t ip);
+bool bridgePingStart(uint16_t count, uint16_t timeoutMs);
+bool bridgePingBusy();
+void bridgePingStop();
+void bridgePingResult(BridgePingResultStruct &res);
+
+// provided by the platform
+uint32_t bridgeMillis();
+uint32_t bridgeMicros();
+uint64_t bridgeTimeUs(); // wall clock, capture timestamps
+int bridgeUartAvailable();
+size_t bridgeUartRead(uint8_t *buf, size_t len);
+void bridgeUartWrite(const uint8_t *buf, size_t len);
+void bridgeTimerArm(uint32_t us); // call bridgeCoreService() again after us, replaces a pending arm
+void bridgeBufLog(BridgeBuf *buf);  // takes its own reference if it keeps the buffer
+void bridgeAllowRejected(const char *entry); // allow-list entry that was not taken, for the log
+void bridgeClientLost(uint8_t cln, bool evicted); // must end in bridgeCoreClientReset(cln)
+int bridgeClientRecv(uint8_t cln, uint8_t *buf, size_t len);       // recv()/send() with MSG_DONTWAIT semantics on the slot,
+int bridgeClientSend(uint8_t cln, const uint8_t *buf, size_t len); // -1 with errno EAGAIN when it would block
+
+#endif // BRIDGE_CORE_H_
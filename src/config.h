@@ -2,8 +2,8 @@
 #define CONFIG_H_
 
 #include <Arduino.h>
-#include <CircularBuffer.hpp>
 #include "version.h"
+#include "bridge_core.h"
 
 // #define DEBUG
 // ESP32 PINS TO CONTROL LAN8720
@@ -34,7 +34,19 @@ const int16_t overseerInterval = 5 * 1000; // check lan or wifi connection every
 const uint8_t overseerMaxRetry = 4;       // 5x4 = 20sec for PHY stability
 const uint8_t LED_USB = 12;                // RED
 const uint8_t LED_PWR = 14;                // BLUE
-const uint8_t MAX_SOCKET_CLIENTS = 5;
+const uint8_t BRIDGE_TASK_PRIORITY = 10;   // above loopTask (1), below lwIP tcpip (18)
+const uint16_t BRIDGE_TASK_STACK = 6144;
+const uint8_t BRIDGE_IDLE_MS = 10;         // max sleep of the bridge task without UART/socket events
+const uint16_t BRIDGE_UART_RX_BUFFER = 4096; // Serial2 driver rx buffer, holds bursts while the rings are full
+const uint8_t BRIDGE_LOG_LINE_BYTES = 64;  // bytes per hex line in the web console
+const uint8_t BRIDGE_LOG_QUEUE_BUFS = 8;   // bursts waiting for the web console hex dump
+const uint8_t BRIDGE_TLS_MAX = 2;          // concurrent TLS bridge clients, about 21 KB of record buffers each
+const uint16_t BRIDGE_TLS_TASK_STACK = 8192; // ECDHE/ECDSA handshake
+const uint16_t BRIDGE_TLS_HANDSHAKE_MS = 5000; // whole handshake, reads and writes included
+const uint8_t WEB_TASK_PRIORITY = 1;       // same as loopTask, well below the bridge task
+const uint16_t WEB_TASK_STACK = 8192;      // handlers run TLS downloads and large JSON documents
+const uint8_t WEB_LOG_STREAMS = 2;         // browsers tailing the log over /events?log
+const uint8_t ZB_UART_RTS_THRESHOLD = 100; // rx FIFO level (of 128) at which RTS is deasserted
 
 enum COORDINATOR_MODE_t : uint8_t
 {
@@ -43,6 +55,12 @@ enum COORDINATOR_MODE_t : uint8_t
   COORDINATOR_MODE_USB
 };
 
+enum BRIDGE_MODE_t : uint8_t
+{
+  BRIDGE_MODE_LOOP, // serviced from loop() together with web, mqtt and timers
+  BRIDGE_MODE_TASK  // dedicated task woken by UART and socket events
+};
+
 extern const char *coordMode;// coordMode node name
 extern const char *prevCoordMode;// prevCoordMode node name
 extern const char *configFileSystem;
@@ -70,10 +88,25 @@ struct ConfigSettingsStruct
   char ipGW[18];
   int serialSpeed;
   int socketPort;
+  int monitorPort; // 0 = off; clients on this port are always monitors
+  int capturePort; // 0 = off; streams ZNP frames as pcapng
+  int tlsPort;     // 0 = off; bridge port wrapped in TLS
+  bool serialFlowCtrl; // RTS/CTS towards the CC2652, needs both pins wired
+  int8_t rtsPin;
+  int8_t ctsPin;
+  BRIDGE_MODE_t bridgeMode;
+  BRIDGE_COALESCE_t bridgeCoalesce;
+  uint16_t coalesceUs;
+  uint16_t coalesceBytes;
+  uint16_t keepIdle; // TCP keepalive on bridge sockets, s; 0 = off
+  uint8_t keepIntvl;
+  uint8_t keepCount;
+  uint16_t writeDeadlineMs; // 0 = off
+  uint16_t holdMs;          // hold-down TTL for coordinator frames while no primary client is attached, 0 = off
   bool disableWeb;
   int refreshLogs;
   char hostname[50];
-  bool connectedSocket[10];
+  bool connectedSocket[MAX_SOCKET_CLIENTS];
   int connectedClients;
   unsigned long socketTime;
   int tempOffset;
@@ -90,11 +123,14 @@ struct ConfigSettingsStruct
   bool apStarted;
   bool wifiWebSetupInProgress;
   bool fwEnabled;
-  IPAddress fwIp;
+  char fwIp[128]; // allow-list, addresses or CIDR ranges separated by commas
 
   bool zbLedState;
   bool zbFlashing;
   char timeZone[50];
+  char logHost[50];   // remote log collector, empty = off
+  uint16_t logPort;
+  uint8_t logFormat;  // LOG_EXPORT_FORMAT_t
 };
 
 struct MqttSettingsStruct
@@ -145,8 +181,6 @@ struct zbVerStruct
   String chipID;
 };
 
-typedef CircularBuffer<char, 8024> LogConsoleType;
-
 // #define WL_MAC_ADDR_LENGTH 6
 
 #ifdef DEBUG
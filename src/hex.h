@@ -0,0 +1,11 @@
+#ifndef HEX_H_
+#define HEX_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Hex dump kernel for the traffic log: a 256 entry table of digit pairs in flash, no printf and no
+// allocation. Writes " xx" per byte, 3 * len chars, no terminator.
+size_t hexFormat(char *out, const uint8_t *data, size_t len);
+
+#endif // HEX_H_
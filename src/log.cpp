@@ -1,41 +1,269 @@
 #include <Arduino.h>
+#include <stdarg.h>
 
 #include "log.h"
 #include "config.h"
 
-LogConsoleType logConsole;
+struct
+{
+  uint8_t ring[LOG_STORE_BYTES];
+  uint32_t head;    // free running
+  uint32_t tail;    // free running, start of the oldest record
+  uint32_t records; // in the ring
+  uint32_t nextSeq;
+} logStore = {{}, 0, 0, 0, 1};
+SemaphoreHandle_t logMutex = xSemaphoreCreateMutex(); // log is written by the bridge task and read by the web server
+
+void logRingPut(const void *data, size_t len)
+{ // at most two memcpy, one at each side of the wrap
+  const uint32_t at = logStore.head & (LOG_STORE_BYTES - 1);
+  const size_t first = min(len, (size_t)(LOG_STORE_BYTES - at));
+  memcpy(logStore.ring + at, data, first);
+  memcpy(logStore.ring, (const uint8_t *)data + first, len - first);
+  logStore.head += len;
+}
 
-void logPush(char c)
+void logRingGet(void *out, const uint8_t *ring, uint32_t at, size_t len)
 {
-  logConsole.push(c);
+  at &= LOG_STORE_BYTES - 1;
+  const size_t first = min(len, (size_t)(LOG_STORE_BYTES - at));
+  memcpy(out, ring + at, first);
+  memcpy((uint8_t *)out + first, ring, len - first);
 }
 
-String logPrint()
+void logWrite(LOG_LEVEL_t level, LOG_SOURCE_t source, uint32_t timeMs, const char *msg, size_t len)
+{ // one record, the oldest ones make room
+  LogRecordHeader header;
+  header.timeMs = timeMs;
+  header.level = level;
+  header.source = source;
+  header.len = min(len, (size_t)LOG_RECORD_MAX);
+  const uint32_t need = sizeof(header) + header.len;
+  xSemaphoreTake(logMutex, portMAX_DELAY);
+  while (LOG_STORE_BYTES - (logStore.head - logStore.tail) < need) {
+    LogRecordHeader oldest;
+    logRingGet(&oldest, logStore.ring, logStore.tail, sizeof(oldest));
+    logStore.tail += sizeof(oldest) + oldest.len;
+    logStore.records--;
+  }
+  header.seq = logStore.nextSeq++;
+  logRingPut(&header, sizeof(header));
+  logRingPut(msg, header.len);
+  logStore.records++;
+  xSemaphoreGive(logMutex);
+}
+
+void logWrite(LOG_LEVEL_t level, LOG_SOURCE_t source, const char *msg, size_t len)
 {
+  logWrite(level, source, millis(), msg, len);
+}
+
+size_t logFormatLine(char *line, const LogRecordHeader &header, const uint8_t *text)
+{ // "[time] | text\n", hex dumps "[time] text\n" as they always looked; line holds LOG_LINE_MAX
+  size_t len = snprintf(line, LOG_LINE_MAX, header.source == LOG_SOURCE_TRAFFIC ? "[%lu] " : "[%lu] | ", (unsigned long)header.timeMs);
+  memcpy(line + len, text, header.len);
+  len += header.len;
+  line[len++] = '\n';
+  line[len] = '\0';
+  return len;
+}
 
+String logFormat(const uint8_t *copy, uint32_t used, uint32_t records)
+{
   String buff = "";
+  buff.reserve(used + records * 16);
+  char line[LOG_LINE_MAX];
+  for (uint32_t at = 0; at < used;) {
+    LogRecordHeader header;
+    memcpy(&header, copy + at, sizeof(header));
+    at += sizeof(header);
+    logFormatLine(line, header, copy + at);
+    buff += line;
+    at += header.len;
+  }
+  return buff;
+}
 
-  if (logConsole.isEmpty()) {
-    return "";
-  } else {
-    for (decltype(logConsole)::index_t i = 0; i < logConsole.size() - 1; i++) {
-      buff += logConsole[i];
+String logPrintSince(uint32_t since, uint32_t &last, uint32_t &lost)
+{ // records with seq > since; a cursor from before a reboot starts over from the oldest record
+  lost = 0;
+  xSemaphoreTake(logMutex, portMAX_DELAY);
+  last = logStore.nextSeq - 1;
+  if (since == last) { // nothing new, the usual poll: no copy, no allocation
+    xSemaphoreGive(logMutex);
+    return String();
+  }
+  if (since > last) {
+    since = 0;
+  }
+  uint32_t from = logStore.tail;
+  uint32_t records = logStore.records;
+  LogRecordHeader header;
+  while (from != logStore.head) { // headers only, skip what the reader already has
+    logRingGet(&header, logStore.ring, from, sizeof(header));
+    if (header.seq > since) {
+      if (since && header.seq > since + 1) {
+        lost = header.seq - since - 1;
+      }
+      break;
     }
-    return buff;
+    from += sizeof(header) + header.len;
+    records--;
+  }
+  if (!logStore.records && since) { // cleared or all overwritten since the last read
+    lost = last - since;
+  }
+  const uint32_t used = logStore.head - from;
+  uint8_t *copy = (uint8_t *)malloc(used ? used : 1);
+  if (copy) { // formatted outside the lock, writers only wait for the copy
+    logRingGet(copy, logStore.ring, from, used);
+  }
+  xSemaphoreGive(logMutex);
+  if (!copy) {
+    return String();
   }
+  String buff = logFormat(copy, used, records);
+  free(copy);
+  return buff;
 }
 
-void logClear()
+void logPrintf(LOG_LEVEL_t level, LOG_SOURCE_t source, const char *fmt, ...)
+{
+  char msg[LOG_PRINTF_MAX];
+  va_list args;
+  va_start(args, fmt);
+  const int len = vsnprintf(msg, sizeof(msg), fmt, args);
+  va_end(args);
+  if (len > 0) {
+    logWrite(level, source, msg, min((size_t)len, sizeof(msg) - 1));
+  }
+}
+
+bool logRateAllow(LogRateStruct &rate, uint32_t ms, LOG_LEVEL_t level, LOG_SOURCE_t source)
+{ // the first message passes, then one per ms; how many were held back is logged with the next one
+  const uint32_t now = millis();
+  if (rate.started && now - rate.last < ms) {
+    rate.suppressed++;
+    return false;
+  }
+  if (rate.suppressed) {
+    logPrintf(level, source, "(%lu similar messages suppressed)", (unsigned long)rate.suppressed);
+  }
+  rate.started = true;
+  rate.last = now;
+  rate.suppressed = 0;
+  return true;
+}
+
+uint32_t logCursorFind(const LogCursor &cursor)
+{ // ring offset of the first record after cursor.seq; the offset kept in the cursor while it is
+  // still valid, a walk over the headers from the tail after records were overwritten or cleared
+  if (cursor.at - logStore.tail <= logStore.head - logStore.tail) {
+    if (cursor.at == logStore.head) {
+      if (cursor.seq == logStore.nextSeq - 1) {
+        return cursor.at;
+      }
+    } else {
+      LogRecordHeader header;
+      logRingGet(&header, logStore.ring, cursor.at, sizeof(header));
+      if (header.seq == cursor.seq + 1) {
+        return cursor.at;
+      }
+    }
+  }
+  uint32_t at = logStore.tail;
+  while (at != logStore.head) {
+    LogRecordHeader header;
+    logRingGet(&header, logStore.ring, at, sizeof(header));
+    if (header.seq > cursor.seq) {
+      break;
+    }
+    at += sizeof(header) + header.len;
+  }
+  return at;
+}
+
+bool logNextRecord(LogCursor &cursor, LOG_LEVEL_t maxLevel, LogRecordHeader &header, uint8_t *text)
+{ // the first record after the cursor at or above maxLevel; the cursor moves past everything looked at
+  xSemaphoreTake(logMutex, portMAX_DELAY);
+  if (cursor.seq == logStore.nextSeq - 1 && cursor.at == logStore.head) {
+    xSemaphoreGive(logMutex);
+    return false;
+  }
+  bool found = false;
+  uint32_t at = logCursorFind(cursor);
+  while (at != logStore.head && !found) {
+    logRingGet(&header, logStore.ring, at, sizeof(header));
+    if (header.level <= maxLevel) {
+      logRingGet(text, logStore.ring, at + sizeof(header), header.len);
+      found = true;
+    }
+    at += sizeof(header) + header.len;
+  }
+  cursor.seq = found ? header.seq : logStore.nextSeq - 1;
+  cursor.at = at;
+  xSemaphoreGive(logMutex);
+  return found;
+}
+
+void logCursorEnd(LogCursor &cursor)
+{ // skips everything stored so far
+  xSemaphoreTake(logMutex, portMAX_DELAY);
+  cursor.seq = logStore.nextSeq - 1;
+  cursor.at = logStore.head;
+  xSemaphoreGive(logMutex);
+}
+
+bool logNextLine(LogCursor &cursor, LOG_LEVEL_t maxLevel, char *line, size_t &len)
+{
+  uint8_t text[LOG_RECORD_MAX];
+  LogRecordHeader header;
+  if (!logNextRecord(cursor, maxLevel, header, text)) {
+    return false;
+  }
+  len = logFormatLine(line, header, text);
+  return true;
+}
+
+void logSerialService()
+{ // Serial gets only what fits into the UART FIFO now, the rest waits in the store and may be
+  // overwritten there; nothing that logs ever waits for 115200 baud
+  static char line[LOG_LINE_MAX];
+  static size_t lineLen = 0;
+  static size_t lineSent = 0;
+  static LogCursor serialCursor = {};
+  for (;;) {
+    if (lineSent == lineLen) {
+      lineLen = lineSent = 0;
+      if (!logNextLine(serialCursor, (LOG_LEVEL_t)LOG_SERIAL_LEVEL, line, lineLen)) {
+        return;
+      }
+    }
+    const int room = Serial.availableForWrite();
+    if (room <= 0) {
+      return;
+    }
+    lineSent += Serial.write((const uint8_t *)line + lineSent, min((size_t)room, lineLen - lineSent));
+  }
+}
+
+uint32_t logLastSeq()
 {
-  Serial.println("\n========== LOG CLEAR ==========");
-  Serial.print("[LOG] Current log buffer size: ");
-  Serial.println(logConsole.size());
-  
-  if (!logConsole.isEmpty()) {
-    logConsole.clear();
-    Serial.println("[LOG] Log buffer cleared successfully");
-  } else {
-    Serial.println("[LOG] Log buffer already empty");
-  }
-  Serial.println("================================\n");
+  return logStore.nextSeq - 1;
+}
+
+String logPrint()
+{
+  uint32_t last, lost;
+  return logPrintSince(0, last, lost);
+}
+
+void logClear()
+{ // reported through the store itself, the note is the first record after the clear
+  xSemaphoreTake(logMutex, portMAX_DELAY);
+  const uint32_t records = logStore.records;
+  logStore.tail = logStore.head;
+  logStore.records = 0;
+  xSemaphoreGive(logMutex);
+  LOG_I(LOG_SOURCE_SYSTEM, "[LOG] Log buffer cleared, %lu records dropped", (unsigned long)records);
 }
@@ -1,3 +1,129 @@
-void logPush(char c);
+#ifndef LOG_H_
+#define LOG_H_
+
+#include <Arduino.h>
+
+// Web console log: binary records in a byte ring, oldest dropped first. A record is a
+// LogRecordHeader followed by len bytes of text without time stamp or newline; it is written with
+// one copy and formatted only when the log is read.
+// Readers poll with the last seq they have seen, logPrintSince() returns only newer records.
+const uint16_t LOG_STORE_BYTES = 8192; // power of two
+const uint16_t LOG_RECORD_MAX = 512;   // longer messages are cut
+const uint16_t LOG_LINE_MAX = 24 + LOG_RECORD_MAX + 2; // formatted: time stamp, text, newline
+const uint16_t LOG_PRINTF_MAX = 192;   // logPrintf() formats on the stack
+
+enum LOG_LEVEL_t : uint8_t
+{
+  LOG_LEVEL_ERROR,
+  LOG_LEVEL_WARN,
+  LOG_LEVEL_INFO,
+  LOG_LEVEL_DEBUG
+};
+
+enum LOG_SOURCE_t : uint8_t
+{
+  LOG_SOURCE_SYSTEM,
+  LOG_SOURCE_BRIDGE,
+  LOG_SOURCE_TRAFFIC, // socket <-> UART hex dumps
+  LOG_SOURCE_ZIGBEE,
+  LOG_SOURCE_WEB,
+  LOG_SOURCE_MQTT,
+  LOG_SOURCE_NET
+};
+
+struct LogRecordHeader
+{
+  uint32_t seq;    // counts from 1 since boot, gaps mean overwritten records
+  uint32_t timeMs; // millis()
+  uint8_t level;   // LOG_LEVEL_t
+  uint8_t source;  // LOG_SOURCE_t
+  uint16_t len;
+};
+
+struct LogCursor
+{ // a sink's place in the store: last record looked at and the ring offset right after it
+  uint32_t seq;
+  uint32_t at;
+};
+
+// Logging facade: LOG_E/LOG_W/LOG_I/LOG_D(source, fmt, ...) write one record. Calls above the level of
+// their module are compiled out; the levels come from build flags, e.g.
+//   -DLOG_MAX=LOG_LEVEL_WARN -DLOG_MAX_NET=LOG_LEVEL_DEBUG
+// LOG_EVERY(ms, level, source, fmt, ...) passes one message per ms per call site and counts the rest.
+// Serial is a sink fed from the store by logSerialService() (records up to LOG_SERIAL_LEVEL), only
+// as far as the UART FIFO has room.
+#ifndef LOG_MAX
+#define LOG_MAX LOG_LEVEL_INFO
+#endif
+#ifndef LOG_MAX_SYSTEM
+#define LOG_MAX_SYSTEM LOG_MAX
+#endif
+#ifndef LOG_MAX_BRIDGE
+#define LOG_MAX_BRIDGE LOG_MAX
+#endif
+#ifndef LOG_MAX_ZIGBEE
+#define LOG_MAX_ZIGBEE LOG_MAX
+#endif
+#ifndef LOG_MAX_WEB
+#define LOG_MAX_WEB LOG_MAX
+#endif
+#ifndef LOG_MAX_MQTT
+#define LOG_MAX_MQTT LOG_MAX
+#endif
+#ifndef LOG_MAX_NET
+#define LOG_MAX_NET LOG_MAX
+#endif
+#ifndef LOG_SERIAL_LEVEL
+#define LOG_SERIAL_LEVEL LOG_LEVEL_INFO
+#endif
+
+constexpr uint8_t logMax(LOG_SOURCE_t source)
+{ // LOG_SOURCE_TRAFFIC hex dumps go to logWrite() directly
+  return source == LOG_SOURCE_SYSTEM   ? LOG_MAX_SYSTEM
+         : source == LOG_SOURCE_BRIDGE ? LOG_MAX_BRIDGE
+         : source == LOG_SOURCE_ZIGBEE ? LOG_MAX_ZIGBEE
+         : source == LOG_SOURCE_WEB    ? LOG_MAX_WEB
+         : source == LOG_SOURCE_MQTT   ? LOG_MAX_MQTT
+         : source == LOG_SOURCE_NET    ? LOG_MAX_NET
+                                       : LOG_LEVEL_DEBUG;
+}
+
+struct LogRateStruct
+{
+  uint32_t last; // millis() of the last message let through
+  uint32_t suppressed;
+  bool started;
+};
+
+#define LOG_AT(level, source, ...)                   \
+  do                                                 \
+  {                                                  \
+    if ((level) <= logMax(source))                   \
+      logPrintf((level), (source), __VA_ARGS__);     \
+  } while (0)
+#define LOG_E(source, ...) LOG_AT(LOG_LEVEL_ERROR, source, __VA_ARGS__)
+#define LOG_W(source, ...) LOG_AT(LOG_LEVEL_WARN, source, __VA_ARGS__)
+#define LOG_I(source, ...) LOG_AT(LOG_LEVEL_INFO, source, __VA_ARGS__)
+#define LOG_D(source, ...) LOG_AT(LOG_LEVEL_DEBUG, source, __VA_ARGS__)
+#define LOG_EVERY(ms, level, source, ...)                                                      \
+  do                                                                                           \
+  {                                                                                            \
+    static LogRateStruct logRate;                                                              \
+    if ((level) <= logMax(source) && logRateAllow(logRate, (ms), (level), (source)))          \
+      logPrintf((level), (source), __VA_ARGS__);                                               \
+  } while (0)
+
+void logPrintf(LOG_LEVEL_t level, LOG_SOURCE_t source, const char *fmt, ...) __attribute__((format(printf, 3, 4)));
+bool logRateAllow(LogRateStruct &rate, uint32_t ms, LOG_LEVEL_t level, LOG_SOURCE_t source);
+void logSerialService();
+bool logNextRecord(LogCursor &cursor, LOG_LEVEL_t maxLevel, LogRecordHeader &header, uint8_t *text);
+void logCursorEnd(LogCursor &cursor);
+size_t logFormatLine(char *line, const LogRecordHeader &header, const uint8_t *text);
+void logWrite(LOG_LEVEL_t level, LOG_SOURCE_t source, uint32_t timeMs, const char *msg, size_t len);
+void logWrite(LOG_LEVEL_t level, LOG_SOURCE_t source, const char *msg, size_t len);
 void logClear();
 String logPrint();
+String logPrintSince(uint32_t since, uint32_t &last, uint32_t &lost);
+uint32_t logLastSeq();
+
+#endif // LOG_H_
@@ -0,0 +1,243 @@
+#include <Arduino.h>
+#include <WiFi.h>
+#include <lwip/sockets.h>
+#include <sys/time.h>
+#include <time.h>
+#include <stdarg.h>
+
+#include "logexport.h"
+#include "config.h"
+
+extern struct ConfigSettingsStruct ConfigSettings;
+
+LogExportStatsStruct LogExportStats = {};
+
+struct
+{ // written by logExportSet(), taken over by the task when changed
+  char host[50];
+  uint16_t port;
+  LOG_EXPORT_FORMAT_t format;
+  bool changed;
+} logExportConfig = {};
+portMUX_TYPE logExportMux = portMUX_INITIALIZER_UNLOCKED;
+TaskHandle_t logExportHandle = NULL;
+
+struct LogDatagram
+{
+  uint16_t len;
+  char data[LOG_EXPORT_DATAGRAM];
+};
+
+struct
+{ // owned by logExportTask
+  LogDatagram queue[LOG_EXPORT_QUEUE];
+  uint8_t head;
+  uint8_t count;
+  LogDatagram staging;     // being filled
+  uint32_t stagingSince;   // millis() of its first record
+  LogCursor cursor;        // last log store record looked at
+  char line[LOG_EXPORT_DATAGRAM];
+  uint8_t text[LOG_RECORD_MAX];
+  int sock;
+  sockaddr_in to;
+} logExport = {};
+
+const char *logSourceNames[] = {"system", "bridge", "traffic", "zigbee", "web", "mqtt", "net"}; // per LOG_SOURCE_t
+const char *logLevelNames[] = {"error", "warn", "info", "debug"};                               // per LOG_LEVEL_t
+const uint8_t logSeverity[] = {3, 4, 6, 7};                                                     // RFC 5424 per LOG_LEVEL_t
+const uint8_t LOG_EXPORT_FACILITY = 16;                                                        // local0
+
+size_t logAppend(char *out, size_t size, size_t at, const char *text, size_t len, const char *special)
+{ // text with a backslash before every char in special, control chars as spaces so a record stays one line
+  for (size_t i = 0; i < len && at + 2 < size; i++)
+  {
+    char c = text[i];
+    if ((uint8_t)c < 0x20)
+      c = ' ';
+    if (strchr(special, c))
+      out[at++] = '\\';
+    out[at++] = c;
+  }
+  return at;
+}
+
+size_t logPrintfAt(char *out, size_t size, size_t at, const char *fmt, ...)
+{ // snprintf at an offset, the result stays inside out
+  va_list args;
+  va_start(args, fmt);
+  const int len = vsnprintf(out + at, size - at, fmt, args);
+  va_end(args);
+  return len < 0 ? at : min(at + len, size - 1);
+}
+
+size_t logExportFormat(char *out, size_t size, LOG_EXPORT_FORMAT_t format, const LogRecordHeader &header,
+                       const uint8_t *text, const char *hostname, uint64_t epochMs)
+{ // one record, no newline; epochMs 0 while the clock is not set
+  const char *source = header.source < sizeof(logSourceNames) / sizeof(logSourceNames[0]) ? logSourceNames[header.source] : "-";
+  const uint8_t level = header.level <= LOG_LEVEL_DEBUG ? header.level : LOG_LEVEL_DEBUG;
+  size_t at;
+  if (format == LOG_EXPORT_LINE)
+  { // gateway_log,host=..,source=..,level=.. seq=1i,uptime_ms=2i,msg="..." [ns]
+    at = logPrintfAt(out, size, 0, "gateway_log,host=");
+    at = logAppend(out, size, at, hostname, strlen(hostname), ", =");
+    at = logPrintfAt(out, size, at, ",source=%s,level=%s seq=%lui,uptime_ms=%lui,msg=\"", source, logLevelNames[level],
+                   (unsigned long)header.seq, (unsigned long)header.timeMs);
+    at = logAppend(out, size, at, (const char *)text, header.len, "\"\\");
+    if (at + 2 < size)
+      out[at++] = '"';
+    if (epochMs)
+      at = logPrintfAt(out, size, at, " %llu000000", (unsigned long long)epochMs);
+  }
+  else
+  { // <PRI>1 TIMESTAMP HOSTNAME APP-NAME PROCID MSGID [meta sequenceId="1"] MSG
+    char stamp[32] = "-";
+    if (epochMs)
+    {
+      const time_t secs = epochMs / 1000;
+      struct tm utc;
+      gmtime_r(&secs, &utc);
+      const size_t len = strftime(stamp, sizeof(stamp), "%Y-%m-%dT%H:%M:%S", &utc);
+      snprintf(stamp + len, sizeof(stamp) - len, ".%03uZ", (unsigned)(epochMs % 1000));
+    }
+    at = logPrintfAt(out, size, 0, "<%u>1 %s %s gateway - %s [meta sequenceId=\"%lu\"] ", LOG_EXPORT_FACILITY * 8 + logSeverity[level],
+                  stamp, hostname[0] ? hostname : "-", source, (unsigned long)header.seq);
+    at = logAppend(out, size, at, (const char *)text, header.len, "");
+  }
+  return at;
+}
+
+void logExportSend()
+{ // never waits: lwIP out of buffers keeps the datagram for the next pass
+  while (logExport.count)
+  {
+    const LogDatagram &datagram = logExport.queue[logExport.head];
+    const int sent = sendto(logExport.sock, datagram.data, datagram.len, MSG_DONTWAIT, (const sockaddr *)&logExport.to, sizeof(logExport.to));
+    if (sent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == ENOMEM))
+      return;
+    if (sent < 0)
+      LogExportStats.dropped++;
+    else
+      LogExportStats.datagrams++;
+    logExport.head = (logExport.head + 1) % LOG_EXPORT_QUEUE;
+    logExport.count--;
+  }
+}
+
+void logExportPush()
+{ // staging datagram into the send queue; if the network still holds all of them the oldest makes room
+  if (!logExport.staging.len)
+    return;
+  if (logExport.count == LOG_EXPORT_QUEUE)
+    logExportSend();
+  if (logExport.count == LOG_EXPORT_QUEUE)
+  {
+    logExport.head = (logExport.head + 1) % LOG_EXPORT_QUEUE;
+    logExport.count--;
+    LogExportStats.dropped++;
+  }
+  logExport.queue[(logExport.head + logExport.count) % LOG_EXPORT_QUEUE] = logExport.staging;
+  logExport.count++;
+  logExport.staging.len = 0;
+}
+
+bool logExportResolve(const char *host, uint16_t port)
+{ // dotted quads are parsed, names go to DNS; blocks this task only
+  IPAddress ip;
+  if (!WiFi.hostByName(host, ip))
+  {
+    LogExportStats.resolveFailures++;
+    return false;
+  }
+  memset(&logExport.to, 0, sizeof(logExport.to));
+  logExport.to.sin_family = AF_INET;
+  logExport.to.sin_port = htons(port);
+  logExport.to.sin_addr.s_addr = (uint32_t)ip;
+  return true;
+}
+
+uint64_t logExportEpochMs(uint32_t timeMs)
+{ // wall clock time of a record, 0 until NTP has set the clock
+  timeval now;
+  gettimeofday(&now, NULL);
+  if (now.tv_sec < 1600000000)
+    return 0;
+  return (uint64_t)now.tv_sec * 1000 + now.tv_usec / 1000 - (millis() - timeMs);
+}
+
+void logExportTask(void *param)
+{
+  char host[sizeof(logExportConfig.host)] = "";
+  uint16_t port = 0;
+  LOG_EXPORT_FORMAT_t format = LOG_EXPORT_SYSLOG;
+  bool resolved = false;
+  uint32_t resolvedAt = 0;
+  LogRecordHeader header;
+  logExport.sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+  for (;;)
+  {
+    vTaskDelay(pdMS_TO_TICKS(LOG_EXPORT_POLL_MS));
+    portENTER_CRITICAL(&logExportMux);
+    const bool changed = logExportConfig.changed;
+    if (changed)
+    {
+      memcpy(host, logExportConfig.host, sizeof(host));
+      port = logExportConfig.port;
+      format = logExportConfig.format;
+      logExportConfig.changed = false;
+    }
+    portEXIT_CRITICAL(&logExportMux);
+    if (changed)
+    { // what was queued for the old collector is dropped
+      resolved = false;
+      logExport.count = 0;
+      logExport.staging.len = 0;
+    }
+    if (!host[0] || !port || logExport.sock < 0)
+    { // off, nothing piles up for later
+      logCursorEnd(logExport.cursor);
+      continue;
+    }
+    if (!resolved || millis() - resolvedAt > 10 * 60 * 1000)
+    { // records wait in the log store meanwhile, at boot the network may not be up yet
+      if (changed || millis() - resolvedAt > 10000)
+      {
+        resolvedAt = millis();
+        resolved = logExportResolve(host, port);
+      }
+      if (!resolved)
+        continue;
+    }
+
+    while (logNextRecord(logExport.cursor, (LOG_LEVEL_t)LOG_EXPORT_LEVEL, header, logExport.text))
+    {
+      const size_t len = logExportFormat(logExport.line, sizeof(logExport.line), format, header, logExport.text,
+                                         ConfigSettings.hostname, logExportEpochMs(header.timeMs));
+      if (logExport.staging.len + len + 1 > sizeof(logExport.staging.data))
+        logExportPush();
+      if (!logExport.staging.len)
+        logExport.stagingSince = millis();
+      memcpy(logExport.staging.data + logExport.staging.len, logExport.line, len);
+      logExport.staging.len += len;
+      LogExportStats.records++;
+      if (format == LOG_EXPORT_SYSLOG)
+        logExportPush(); // RFC 5426: one syslog message per datagram
+      else
+        logExport.staging.data[logExport.staging.len++] = '\n';
+    }
+    if (logExport.staging.len && millis() - logExport.stagingSince >= LOG_EXPORT_FLUSH_MS)
+      logExportPush();
+    logExportSend();
+  }
+}
+
+void logExportSet(const char *host, uint16_t port, LOG_EXPORT_FORMAT_t format)
+{ // from the config loader and the web server; the task is started with the first host
+  portENTER_CRITICAL(&logExportMux);
+  strlcpy(logExportConfig.host, host, sizeof(logExportConfig.host));
+  logExportConfig.port = port;
+  logExportConfig.format = format;
+  logExportConfig.changed = true;
+  portEXIT_CRITICAL(&logExportMux);
+  if (host[0] && !logExportHandle)
+    xTaskCreate(logExportTask, "logExport", LOG_EXPORT_TASK_STACK, NULL, WEB_TASK_PRIORITY, &logExportHandle);
+}
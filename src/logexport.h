@@ -0,0 +1,44 @@
+#ifndef LOGEXPORT_H_
+#define LOGEXPORT_H_
+
+#include <Arduino.h>
+#include "log.h"
+
+// Remote log over UDP. Records up to LOG_EXPORT_LEVEL are read from the log store by a low priority
+// task: RFC 5424 syslog (facility local0, sequenceId in the "meta" SD element), one message per
+// datagram as RFC 5426 wants, or InfluxDB style line protocol, packed newline separated into
+// datagrams of up to LOG_EXPORT_DATAGRAM bytes that go out when full or LOG_EXPORT_FLUSH_MS after
+// their first record. Sends never wait; at most LOG_EXPORT_QUEUE datagrams wait for the network,
+// the oldest is dropped beyond that, so a slow or missing collector only costs log lines. Try it with
+//   nc -u -l 5514
+// and the gateway's remote log host set to this machine, port 5514.
+const uint16_t LOG_EXPORT_DATAGRAM = 1200; // below the usual path MTU, no IP fragments
+const uint8_t LOG_EXPORT_QUEUE = 4;
+const uint16_t LOG_EXPORT_FLUSH_MS = 1000;
+const uint16_t LOG_EXPORT_POLL_MS = 100;
+const uint16_t LOG_EXPORT_TASK_STACK = 4096;
+#ifndef LOG_EXPORT_LEVEL
+#define LOG_EXPORT_LEVEL LOG_LEVEL_INFO
+#endif
+
+enum LOG_EXPORT_FORMAT_t : uint8_t
+{
+  LOG_EXPORT_SYSLOG,
+  LOG_EXPORT_LINE
+};
+
+struct LogExportStatsStruct
+{
+  uint32_t records;   // formatted into datagrams
+  uint32_t datagrams; // sent
+  uint32_t dropped;   // datagrams dropped, queue full or send error
+  uint32_t resolveFailures;
+};
+
+extern LogExportStatsStruct LogExportStats;
+
+void logExportSet(const char *host, uint16_t port, LOG_EXPORT_FORMAT_t format);
+size_t logExportFormat(char *out, size_t size, LOG_EXPORT_FORMAT_t format, const LogRecordHeader &header,
+                       const uint8_t *text, const char *hostname, uint64_t epochMs);
+
+#endif // LOGEXPORT_H_
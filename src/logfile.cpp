@@ -0,0 +1,236 @@
+#include <Arduino.h>
+#include <LittleFS.h>
+#include <esp_attr.h>
+#include <esp_system.h>
+
+#include "logfile.h"
+#include "version.h"
+
+const uint32_t LOG_FILE_MAGIC = 0x31474f4c; // "LOG1"
+const char *logFileDir = "/log";
+
+struct LogSegmentHeader
+{ // first bytes of every segment file, records follow as in the log store
+  uint32_t magic;
+  uint32_t number; // one more for every new segment, the highest is being appended to
+};
+
+struct LogFileBatchStruct
+{
+  uint32_t magic;
+  uint32_t len;
+  uint8_t data[LOG_FILE_BATCH_BYTES];
+};
+static __NOINIT_ATTR LogFileBatchStruct logBatch; // survives software, panic and watchdog resets
+
+struct
+{
+  uint8_t segment;     // file being appended to
+  uint32_t number;
+  uint32_t size;
+  LogCursor cursor;    // last log store record looked at
+  uint32_t batchSince; // millis() of the oldest record in the batch
+  bool ready;
+} logFile = {};
+SemaphoreHandle_t logFileMutex = NULL; // loop() writes, the web server reads history, restarts flush
+
+String logSegmentPath(uint8_t segment)
+{
+  return String(logFileDir) + "/" + segment + ".bin";
+}
+
+const char *logResetReason(esp_reset_reason_t reason)
+{
+  switch (reason)
+  {
+  case ESP_RST_POWERON:
+    return "power on";
+  case ESP_RST_EXT:
+    return "external reset";
+  case ESP_RST_SW:
+    return "restart";
+  case ESP_RST_PANIC:
+    return "panic";
+  case ESP_RST_INT_WDT:
+    return "interrupt watchdog";
+  case ESP_RST_TASK_WDT:
+    return "task watchdog";
+  case ESP_RST_WDT:
+    return "watchdog";
+  case ESP_RST_DEEPSLEEP:
+    return "deep sleep";
+  case ESP_RST_BROWNOUT:
+    return "brownout";
+  default:
+    return "unknown";
+  }
+}
+
+bool logBatchValid()
+{ // after power on the noinit memory holds noise
+  if (logBatch.magic != LOG_FILE_MAGIC || logBatch.len > sizeof(logBatch.data))
+    return false;
+  for (uint32_t at = 0; at < logBatch.len;)
+  {
+    LogRecordHeader header;
+    if (logBatch.len - at < sizeof(header))
+      return false;
+    memcpy(&header, logBatch.data + at, sizeof(header));
+    if (header.len > LOG_RECORD_MAX || header.level > LOG_LEVEL_DEBUG)
+      return false;
+    at += sizeof(header) + header.len;
+    if (at > logBatch.len)
+      return false;
+  }
+  return true;
+}
+
+void logSegmentNext()
+{ // the oldest segment becomes the newest
+  logFile.segment = (logFile.segment + 1) % LOG_FILE_SEGMENTS;
+  logFile.number++;
+  logFile.size = 0;
+  File file = LittleFS.open(logSegmentPath(logFile.segment), FILE_WRITE);
+  if (file)
+  {
+    const LogSegmentHeader header = {LOG_FILE_MAGIC, logFile.number};
+    logFile.size = file.write((const uint8_t *)&header, sizeof(header));
+    file.close();
+  }
+}
+
+void logBatchWrite()
+{ // caller holds logFileMutex; a failed write drops the batch rather than retrying on every pass
+  if (!logBatch.len)
+    return;
+  if (logFile.size + logBatch.len > LOG_FILE_SEGMENT_BYTES)
+    logSegmentNext();
+  File file = LittleFS.open(logSegmentPath(logFile.segment), FILE_APPEND);
+  if (file)
+  {
+    logFile.size += file.write(logBatch.data, logBatch.len);
+    file.close();
+  }
+  logBatch.len = 0;
+}
+
+void logFileShutdown()
+{
+  logFileFlush();
+}
+
+void logFileBegin()
+{ // after LittleFS.begin()
+  logFileMutex = xSemaphoreCreateMutex();
+  LittleFS.mkdir(logFileDir);
+  for (uint8_t i = 0; i < LOG_FILE_SEGMENTS; i++)
+  {
+    if (!LittleFS.exists(logSegmentPath(i)))
+      continue;
+    File file = LittleFS.open(logSegmentPath(i), FILE_READ);
+    LogSegmentHeader header;
+    if (file.read((uint8_t *)&header, sizeof(header)) == sizeof(header) && header.magic == LOG_FILE_MAGIC && header.number > logFile.number)
+    {
+      logFile.number = header.number;
+      logFile.segment = i;
+      logFile.size = file.size();
+    }
+    file.close();
+  }
+  if (!logFile.number)
+  { // first boot, start with segment 0
+    logFile.segment = LOG_FILE_SEGMENTS - 1;
+    logSegmentNext();
+  }
+
+  const esp_reset_reason_t reason = esp_reset_reason();
+  if (reason != ESP_RST_POWERON && logBatchValid())
+    logBatchWrite(); // what the previous run logged last, before it crashed
+  logBatch.magic = LOG_FILE_MAGIC;
+  logBatch.len = 0;
+  logFile.ready = true;
+  esp_register_shutdown_handler(logFileShutdown);
+
+  const bool crash = reason == ESP_RST_PANIC || reason == ESP_RST_INT_WDT || reason == ESP_RST_TASK_WDT ||
+                     reason == ESP_RST_WDT || reason == ESP_RST_BROWNOUT;
+  if (crash)
+    LOG_W(LOG_SOURCE_SYSTEM, "boot %s, reset reason: %s", VERSION, logResetReason(reason));
+  else
+    LOG_I(LOG_SOURCE_SYSTEM, "boot %s, reset reason: %s", VERSION, logResetReason(reason));
+}
+
+void logFileService()
+{ // from loop(), moves new records into the batch and writes it when due
+  if (!logFile.ready)
+    return;
+  LogRecordHeader header;
+  uint8_t text[LOG_RECORD_MAX];
+  xSemaphoreTake(logFileMutex, portMAX_DELAY);
+  while (logNextRecord(logFile.cursor, (LOG_LEVEL_t)LOG_FILE_LEVEL, header, text))
+  {
+    const uint32_t need = sizeof(header) + header.len;
+    if (logBatch.len + need > sizeof(logBatch.data))
+      logBatchWrite();
+    if (!logBatch.len)
+      logFile.batchSince = millis();
+    memcpy(logBatch.data + logBatch.len, &header, sizeof(header));
+    memcpy(logBatch.data + logBatch.len + sizeof(header), text, header.len);
+    logBatch.len += need; // only now, a reset in between leaves a valid batch
+  }
+  if (logBatch.len && millis() - logFile.batchSince >= LOG_FILE_FLUSH_MS)
+    logBatchWrite();
+  xSemaphoreGive(logFileMutex);
+}
+
+void logFileFlush()
+{
+  if (!logFile.ready)
+    return;
+  logFileService();
+  xSemaphoreTake(logFileMutex, portMAX_DELAY);
+  logBatchWrite();
+  xSemaphoreGive(logFileMutex);
+}
+
+void logFileHistory(LogFileSink sink)
+{ // oldest segment first, one record at a time; the writer is not held up meanwhile, a segment
+  // rotated during the read just ends early
+  if (!logFile.ready)
+    return;
+  logFileFlush();
+  xSemaphoreTake(logFileMutex, portMAX_DELAY);
+  const uint8_t newest = logFile.segment;
+  xSemaphoreGive(logFileMutex);
+
+  char out[1024];
+  char line[LOG_LINE_MAX];
+  uint8_t text[LOG_RECORD_MAX];
+  for (uint8_t n = 1; n <= LOG_FILE_SEGMENTS; n++)
+  {
+    const String path = logSegmentPath((newest + n) % LOG_FILE_SEGMENTS);
+    if (!LittleFS.exists(path))
+      continue;
+    File file = LittleFS.open(path, FILE_READ);
+    LogSegmentHeader segment;
+    LogRecordHeader header;
+    size_t outLen = 0;
+    if (file.read((uint8_t *)&segment, sizeof(segment)) == sizeof(segment) && segment.magic == LOG_FILE_MAGIC)
+    {
+      while (file.read((uint8_t *)&header, sizeof(header)) == sizeof(header) && header.len <= LOG_RECORD_MAX &&
+             file.read(text, header.len) == header.len)
+      {
+        const size_t len = logFormatLine(line, header, text);
+        if (outLen + len > sizeof(out))
+        {
+          sink(out, outLen);
+          outLen = 0;
+        }
+        memcpy(out + outLen, line, len);
+        outLen += len;
+      }
+    }
+    if (outLen)
+      sink(out, outLen);
+    file.close();
+  }
+}
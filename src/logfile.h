@@ -0,0 +1,27 @@
+#ifndef LOGFILE_H_
+#define LOGFILE_H_
+
+#include <Arduino.h>
+#include "log.h"
+
+// Log history on LittleFS. Records up to LOG_FILE_LEVEL are taken from the log store into a batch and
+// appended to the newest of LOG_FILE_SEGMENTS segment files in /log when the batch is full, when its
+// oldest record is LOG_FILE_FLUSH_MS old and on ESP.restart(); flash sees one append per batch. A
+// full segment rotates to the oldest file, which is rewritten from the start. The batch lives in
+// memory that keeps its content over panic and watchdog resets, the next boot writes it out.
+const uint8_t LOG_FILE_SEGMENTS = 4;
+const uint32_t LOG_FILE_SEGMENT_BYTES = 64 * 1024;
+const uint16_t LOG_FILE_BATCH_BYTES = 4096;
+const uint32_t LOG_FILE_FLUSH_MS = 5 * 60 * 1000;
+#ifndef LOG_FILE_LEVEL
+#define LOG_FILE_LEVEL LOG_LEVEL_INFO
+#endif
+
+typedef void (*LogFileSink)(const char *data, size_t len);
+
+void logFileBegin();
+void logFileService();
+void logFileFlush();
+void logFileHistory(LogFileSink sink);
+
+#endif // LOGFILE_H_
@@ -18,17 +18,18 @@
 #include "config.h"
 #include "web.h"
 #include "log.h"
+#include "logfile.h"
+#include "logexport.h"
 #include "etc.h"
 #include "mqtt.h"
 #include "zb.h"
+#include "bridge.h"
 #include "version.h"
 
 #ifdef ETH_CLK_MODE
 #undef ETH_CLK_MODE
 #endif
 
-#define BUFFER_SIZE 256
-
 ConfigSettingsStruct ConfigSettings;
 zbVerStruct zbVer;
 // InfosStruct Infos;
@@ -37,7 +38,6 @@ WgSettingsStruct WgSettings;
 
 // volatile bool btnFlag = false;
 int btnFlag = false;
-bool updWeb = false;
 
 void mDNS_start();
 void connectWifi();
@@ -52,7 +52,6 @@ Ticker tmrNetworkOverseer(handleTmrNetworkOverseer, overseerInterval, 0, MILLIS)
 
 IPAddress apIP(192, 168, 1, 1);
 DNSServer dnsServer;
-WiFiServer server(TCP_LISTEN_PORT, MAX_SOCKET_CLIENTS);
 
 static WireGuard wg;
 
@@ -61,17 +60,10 @@ extern CCTools CCTool;
 
 void initLan()
 {
-  Serial.println(F("\n[LAN] ======== initLan() START ========"));
-  Serial.print(F("[LAN] ETH_ADDR=")); Serial.print(ETH_ADDR_1);
-  Serial.print(F(" PWR_PIN=")); Serial.print(ETH_POWER_PIN_1);
-  Serial.print(F(" MDC=")); Serial.print(ETH_MDC_PIN_1);
-  Serial.print(F(" MDIO=")); Serial.print(ETH_MDIO_PIN_1);
-  Serial.print(F(" PWR_ALT=")); Serial.println(ETH_POWER_PIN_ALTERNATIVE_1);
-  Serial.print(F("[LAN] DHCP=")); Serial.println(ConfigSettings.dhcp);
+  LOG_D(LOG_SOURCE_NET, "[LAN] ETH_ADDR=%d PWR_PIN=%d MDC=%d MDIO=%d PWR_ALT=%d DHCP=%d",
+        ETH_ADDR_1, ETH_POWER_PIN_1, ETH_MDC_PIN_1, ETH_MDIO_PIN_1, ETH_POWER_PIN_ALTERNATIVE_1, ConfigSettings.dhcp);
   if (!ConfigSettings.dhcp) {
-    Serial.print(F("[LAN] Static IP=")); Serial.println(ConfigSettings.ipAddress);
-    Serial.print(F("[LAN] Static GW=")); Serial.println(ConfigSettings.ipGW);
-    Serial.print(F("[LAN] Static Mask=")); Serial.println(ConfigSettings.ipMask);
+    LOG_D(LOG_SOURCE_NET, "[LAN] Static IP=%s GW=%s Mask=%s", ConfigSettings.ipAddress, ConfigSettings.ipGW, ConfigSettings.ipMask);
   }
 
   // Hardware reset LAN8720 PHY via GPIO5 to ensure clean state after ESP.restart()
@@ -83,29 +75,21 @@ void initLan()
 
   if (ETH.begin(ETH_ADDR_1, ETH_POWER_PIN_1, ETH_MDC_PIN_1, ETH_MDIO_PIN_1, ETH_TYPE_1, ETH_CLK_MODE_1, ETH_POWER_PIN_ALTERNATIVE_1))
   {
-    Serial.println(F("[LAN] ETH.begin() SUCCESS"));
     if (!ConfigSettings.dhcp)
     {
-      Serial.println(F("[LAN] Configuring static IP..."));
       ETH.config(parse_ip_address(ConfigSettings.ipAddress), parse_ip_address(ConfigSettings.ipGW), parse_ip_address(ConfigSettings.ipMask));
-      Serial.println(F("[LAN] Static IP configured"));
-    }
-    else
-    {
-      Serial.println(F("[LAN] Using DHCP"));
     }
+    LOG_I(LOG_SOURCE_NET, "[LAN] ETH started, %s", ConfigSettings.dhcp ? "DHCP" : "static IP");
   }
   else
   {
-    Serial.println(F("[LAN] ETH.begin() FAILED!"));
+    LOG_E(LOG_SOURCE_NET, "[LAN] ETH.begin() failed");
   }
-  Serial.println(F("[LAN] ======== initLan() END ========\n"));
 }
 
 void startSocketServer()
 {
-  server.begin(ConfigSettings.socketPort);
-  server.setNoDelay(true);
+  bridgeServerBegin();
 }
 
 void wgBegin()
@@ -133,10 +117,8 @@ void wgBegin()
 
 void startServers(bool usb = false)
 {
-  Serial.print(F("[SRV] startServers() called, usb=")); Serial.println(usb);
-  Serial.print(F("[SRV] connectedEther=")); Serial.println(ConfigSettings.connectedEther);
-  Serial.print(F("[SRV] WiFi.isConnected=")); Serial.println(WiFi.isConnected());
-  Serial.print(F("[SRV] apStarted=")); Serial.println(ConfigSettings.apStarted);
+  LOG_D(LOG_SOURCE_NET, "[SRV] startServers usb=%d connectedEther=%d WiFi.isConnected=%d apStarted=%d",
+        usb, ConfigSettings.connectedEther, WiFi.isConnected(), ConfigSettings.apStarted);
   initWebServer();
   if (!usb)
     startSocketServer();
@@ -154,11 +136,10 @@ void handleTmrNetworkOverseer()
   switch (ConfigSettings.coordinator_mode)
   {
   case COORDINATOR_MODE_WIFI:
-    DEBUG_PRINT(F("WiFi.status = "));
-    DEBUG_PRINTLN(WiFi.status());
+    LOG_EVERY(30000, LOG_LEVEL_DEBUG, LOG_SOURCE_NET, "[OVERSEER] WiFi.status=%d", WiFi.status());
     if (WiFi.isConnected())
     {
-      DEBUG_PRINTLN(F("WIFI CONNECTED"));
+      LOG_I(LOG_SOURCE_NET, "[OVERSEER] WiFi connected, starting servers");
       startServers();
       tmrNetworkOverseer.stop();
     }
@@ -166,21 +147,18 @@ void handleTmrNetworkOverseer()
     {
       if (tmrNetworkOverseer.counter() > overseerMaxRetry)
       {
-        DEBUG_PRINTLN(F("WIFI counter overflow"));
+        LOG_W(LOG_SOURCE_NET, "[OVERSEER] WiFi timeout, starting AP");
         startAP(true);
         connectWifi();
       }
     }
     break;
   case COORDINATOR_MODE_LAN:
-    Serial.print(F("[OVERSEER] LAN check: connectedEther="));
-    Serial.print(ConfigSettings.connectedEther);
-    Serial.print(F(" counter="));
-    Serial.println(tmrNetworkOverseer.counter());
+    LOG_EVERY(30000, LOG_LEVEL_DEBUG, LOG_SOURCE_NET, "[OVERSEER] LAN check: connectedEther=%d counter=%lu",
+              ConfigSettings.connectedEther, (unsigned long)tmrNetworkOverseer.counter());
     if (ConfigSettings.connectedEther)
     {
-      DEBUG_PRINTLN(F("LAN CONNECTED"));
-      Serial.println(F("[OVERSEER] LAN connected! Starting servers..."));
+      LOG_I(LOG_SOURCE_NET, "[OVERSEER] LAN connected, starting servers");
       startServers();
       tmrNetworkOverseer.stop();
     }
@@ -188,12 +166,8 @@ void handleTmrNetworkOverseer()
     {
       if (tmrNetworkOverseer.counter() > overseerMaxRetry)
       {
-        DEBUG_PRINTLN(F("LAN counter overflow"));
-        Serial.print(F("[OVERSEER] LAN timeout! counter="));
-        Serial.print(tmrNetworkOverseer.counter());
-        Serial.print(F(" > maxRetry="));
-        Serial.println(overseerMaxRetry);
-        Serial.println(F("[OVERSEER] Starting AP as fallback..."));
+        LOG_EVERY(60000, LOG_LEVEL_WARN, LOG_SOURCE_NET, "[OVERSEER] LAN timeout after %lu checks, starting AP",
+                  (unsigned long)tmrNetworkOverseer.counter());
         startAP(true);
       }
     }
@@ -233,66 +207,49 @@ void handleTmrNetworkOverseer()
 
 void NetworkEvent(WiFiEvent_t event)
 {
-  Serial.print(F("[NET_EVENT] Event ID: "));
-  Serial.println(event);
+  LOG_D(LOG_SOURCE_NET, "[NET_EVENT] Event ID: %d", event);
   switch (event)
   {
   case ARDUINO_EVENT_ETH_START:
-    Serial.println(F("[ETH_EVENT] ETH Started"));
-    Serial.print(F("[ETH_EVENT] Setting hostname: ")); Serial.println(ConfigSettings.hostname);
+    LOG_D(LOG_SOURCE_NET, "[ETH_EVENT] ETH started, hostname %s", ConfigSettings.hostname);
     ETH.setHostname(ConfigSettings.hostname);
     break;
   case ARDUINO_EVENT_ETH_CONNECTED:
-    Serial.println(F("[ETH_EVENT] ETH Connected (link up)"));
+    LOG_I(LOG_SOURCE_NET, "[ETH_EVENT] link up");
     break;
   case ARDUINO_EVENT_ETH_GOT_IP:
-    Serial.println(F("[ETH_EVENT] ======== ETH GOT IP ========"));
-    Serial.print(F("[ETH_EVENT] MAC: ")); Serial.println(ETH.macAddress());
-    Serial.print(F("[ETH_EVENT] IPv4: ")); Serial.println(ETH.localIP());
-    Serial.print(F("[ETH_EVENT] Subnet: ")); Serial.println(ETH.subnetMask());
-    Serial.print(F("[ETH_EVENT] Gateway: ")); Serial.println(ETH.gatewayIP());
-    if (ETH.fullDuplex())
-    {
-      Serial.println(F("[ETH_EVENT] FULL_DUPLEX"));
-    }
-    Serial.print(F("[ETH_EVENT] Speed: ")); Serial.print(ETH.linkSpeed()); Serial.println(F("Mbps"));
+    LOG_I(LOG_SOURCE_NET, "[ETH_EVENT] MAC %s, IPv4 %s, mask %s, gateway %s, %s %u Mbps",
+          ETH.macAddress().c_str(), ETH.localIP().toString().c_str(), ETH.subnetMask().toString().c_str(),
+          ETH.gatewayIP().toString().c_str(), ETH.fullDuplex() ? "FULL_DUPLEX" : "HALF_DUPLEX", ETH.linkSpeed());
     ConfigSettings.connectedEther = true;
-    Serial.println(F("[ETH_EVENT] connectedEther = true"));
-    Serial.println(F("[ETH_EVENT] ========================"));
     setClock();
     break;
   case ARDUINO_EVENT_ETH_DISCONNECTED: // 21:  //SYSTEM_EVENT_ETH_DISCONNECTED:
-    Serial.println(F("[ETH_EVENT] ETH Disconnected"));
-    Serial.print(F("[ETH_EVENT] coordinator_mode=")); Serial.println(ConfigSettings.coordinator_mode);
+    LOG_W(LOG_SOURCE_NET, "[ETH_EVENT] link down, coordinator_mode=%d", ConfigSettings.coordinator_mode);
     ConfigSettings.connectedEther = false;
     if (tmrNetworkOverseer.state() == STOPPED && ConfigSettings.coordinator_mode == COORDINATOR_MODE_LAN)
     {
-      Serial.println(F("[ETH_EVENT] Restarting overseer for LAN mode"));
+      LOG_D(LOG_SOURCE_NET, "[ETH_EVENT] Restarting overseer for LAN mode");
       tmrNetworkOverseer.start();
     }
     break;
   case SYSTEM_EVENT_ETH_STOP:
   case ARDUINO_EVENT_ETH_STOP:
-    Serial.println(F("[ETH_EVENT] ETH Stopped"));
+    LOG_I(LOG_SOURCE_NET, "[ETH_EVENT] ETH stopped");
     ConfigSettings.connectedEther = false;
     if (tmrNetworkOverseer.state() == STOPPED)
     {
-      Serial.println(F("[ETH_EVENT] Restarting overseer after ETH stop"));
+      LOG_D(LOG_SOURCE_NET, "[ETH_EVENT] Restarting overseer after ETH stop");
       tmrNetworkOverseer.start();
     }
     break;
   case ARDUINO_EVENT_WIFI_STA_GOT_IP:
-    DEBUG_PRINTLN(F("WiFi"));
-    DEBUG_PRINT(F("IPv4: "));
-    DEBUG_PRINT(WiFi.localIP().toString());
-    DEBUG_PRINT(F(", "));
-    DEBUG_PRINT(WiFi.subnetMask().toString());
-    DEBUG_PRINT(F(", "));
-    DEBUG_PRINTLN(WiFi.gatewayIP().toString());
+    LOG_I(LOG_SOURCE_NET, "[WIFI_EVENT] IPv4 %s, mask %s, gateway %s", WiFi.localIP().toString().c_str(),
+          WiFi.subnetMask().toString().c_str(), WiFi.gatewayIP().toString().c_str());
     setClock();
     break;
   case ARDUINO_EVENT_WIFI_STA_DISCONNECTED: // SYSTEM_EVENT_STA_DISCONNECTED:
-    DEBUG_PRINTLN(F("WIFI STA DISCONNECTED"));
+    LOG_EVERY(10000, LOG_LEVEL_WARN, LOG_SOURCE_NET, "[WIFI_EVENT] STA disconnected");
     if (tmrNetworkOverseer.state() == STOPPED)
     {
       tmrNetworkOverseer.start();
@@ -487,6 +444,9 @@ bool loadConfigGeneral()
   const char *prevCoordMode = "prevCoordMode";
   const char *keepWeb = "keepWeb";
   const char *timeZoneName = "timeZoneName";
+  const char *logHost = "logHost";
+  const char *logPort = "logPort";
+  const char *logFormat = "logFormat";
   File configFile = LittleFS.open(configFileGeneral, FILE_READ);
   DEBUG_PRINTLN(configFile.readString());
   if (!configFile)
@@ -545,6 +505,10 @@ bool loadConfigGeneral()
   ConfigSettings.keepWeb = (uint8_t)doc[keepWeb];
   // DEBUG_PRINTLN(F("[loadConfigGeneral] disableLeds"));
   strlcpy(ConfigSettings.timeZone, doc[timeZoneName] | "", sizeof(ConfigSettings.timeZone));
+  strlcpy(ConfigSettings.logHost, doc[logHost] | "", sizeof(ConfigSettings.logHost));
+  ConfigSettings.logPort = doc[logPort] | 514;
+  ConfigSettings.logFormat = min((uint8_t)(doc[logFormat] | 0), (uint8_t)LOG_EXPORT_LINE);
+  logExportSet(ConfigSettings.logHost, ConfigSettings.logPort, (LOG_EXPORT_FORMAT_t)ConfigSettings.logFormat);
   configFile.close();
   DEBUG_PRINTLN(F("[loadConfigGeneral] config load done"));
   return true;
@@ -591,7 +555,8 @@ bool loadConfigSecurity()
   strlcpy(ConfigSettings.webUser, doc[webUser] | "", sizeof(ConfigSettings.webUser));
   strlcpy(ConfigSettings.webPass, doc[webPass] | "", sizeof(ConfigSettings.webPass));
   ConfigSettings.fwEnabled = (uint8_t)doc[fwEnabled];
-  ConfigSettings.fwIp = parse_ip_address(doc[fwIp] | "0.0.0.0");
+  strlcpy(ConfigSettings.fwIp, doc[fwIp] | "", sizeof(ConfigSettings.fwIp));
+  bridgeAllowSet(ConfigSettings.fwIp);
 
   configFile.close();
   return true;
@@ -601,6 +566,21 @@ bool loadConfigSerial()
 {
   const char *baud = "baud";
   const char *port = "port";
+  const char *bridgeMode = "bridgeMode";
+  const char *monitorPort = "monitorPort";
+  const char *capturePort = "capturePort";
+  const char *tlsPort = "tlsPort";
+  const char *flowCtrl = "flowCtrl";
+  const char *rtsPin = "rtsPin";
+  const char *ctsPin = "ctsPin";
+  const char *coalesce = "coalesce";
+  const char *coalesceUs = "coalesceUs";
+  const char *coalesceBytes = "coalesceBytes";
+  const char *keepIdle = "keepIdle";
+  const char *keepIntvl = "keepIntvl";
+  const char *keepCount = "keepCount";
+  const char *writeDeadline = "writeDeadline";
+  const char *holdDown = "holdDown";
   File configFile = LittleFS.open(configFileSerial, FILE_READ);
   if (!configFile)
   {
@@ -608,6 +588,21 @@ bool loadConfigSerial()
     DynamicJsonDocument doc(1024);
     doc[baud] = 115200;
     doc[port] = 6638;
+    doc[bridgeMode] = BRIDGE_MODE_TASK;
+    doc[monitorPort] = 0;
+    doc[capturePort] = 0;
+    doc[tlsPort] = 0;
+    doc[flowCtrl] = 0;
+    doc[rtsPin] = -1;
+    doc[ctsPin] = -1;
+    doc[coalesce] = BRIDGE_COALESCE_IMMEDIATE;
+    doc[coalesceUs] = 500;
+    doc[coalesceBytes] = BRIDGE_BUF_SIZE;
+    doc[keepIdle] = 5;
+    doc[keepIntvl] = 2;
+    doc[keepCount] = 3;
+    doc[writeDeadline] = 5000;
+    doc[holdDown] = 0;
     writeDefaultConfig(configFileSerial, doc);
   }
 
@@ -631,6 +626,21 @@ bool loadConfigSerial()
   {
     ConfigSettings.socketPort = TCP_LISTEN_PORT;
   }
+  ConfigSettings.bridgeMode = (uint8_t)(doc[bridgeMode] | BRIDGE_MODE_TASK) == BRIDGE_MODE_LOOP ? BRIDGE_MODE_LOOP : BRIDGE_MODE_TASK;
+  ConfigSettings.monitorPort = (int)doc[monitorPort];
+  ConfigSettings.capturePort = (int)doc[capturePort];
+  ConfigSettings.tlsPort = (int)doc[tlsPort];
+  ConfigSettings.serialFlowCtrl = (uint8_t)doc[flowCtrl];
+  ConfigSettings.rtsPin = doc[rtsPin] | -1;
+  ConfigSettings.ctsPin = doc[ctsPin] | -1;
+  ConfigSettings.bridgeCoalesce = static_cast<BRIDGE_COALESCE_t>(min((uint8_t)doc[coalesce], (uint8_t)BRIDGE_COALESCE_FRAME));
+  ConfigSettings.coalesceUs = doc[coalesceUs] | 500;
+  ConfigSettings.coalesceBytes = constrain((uint16_t)(doc[coalesceBytes] | BRIDGE_BUF_SIZE), 1, BRIDGE_BUF_SIZE);
+  ConfigSettings.keepIdle = doc[keepIdle] | 5;
+  ConfigSettings.keepIntvl = max((uint8_t)(doc[keepIntvl] | 2), (uint8_t)1);
+  ConfigSettings.keepCount = max((uint8_t)(doc[keepCount] | 3), (uint8_t)1);
+  ConfigSettings.writeDeadlineMs = doc[writeDeadline] | 5000;
+  ConfigSettings.holdMs = min((uint16_t)doc[holdDown], (uint16_t)60000);
   configFile.close();
   return true;
 }
@@ -742,11 +752,9 @@ bool loadConfigWg()
 
 void startAP(const bool start)
 {
-  Serial.print("[startAP] Called with start=");
-  Serial.println(start);
+  LOG_D(LOG_SOURCE_NET, "[startAP] start=%d apStarted=%d", start, ConfigSettings.apStarted);
   if (ConfigSettings.apStarted)
   {
-    Serial.println("[startAP] AP already started");
     if (!start)
     {
       if (ConfigSettings.coordinator_mode != COORDINATOR_MODE_WIFI)
@@ -777,18 +785,14 @@ void startAP(const bool start)
     //   AP_NameChar[i] = AP_NameString.charAt(i);
     // }
 
-    Serial.println("[startAP] Starting AP mode...");
     WiFi.softAPConfig(apIP, apIP, IPAddress(255, 255, 255, 0));
     char apSsid[32];  // Increased to 32 to safely hold SSID + null terminator
     getDeviceID(apSsid);
-    Serial.print("[startAP] SSID: ");
-    Serial.println(apSsid);
     bool apResult = WiFi.softAP(apSsid); //, WIFIPASS);
-    Serial.print("[startAP] softAP result: ");
-    Serial.println(apResult ? "SUCCESS" : "FAILED");
     if (apResult) {
-      Serial.print("[startAP] AP IP: ");
-      Serial.println(WiFi.softAPIP());
+      LOG_I(LOG_SOURCE_NET, "[startAP] AP %s at %s", apSsid, WiFi.softAPIP().toString().c_str());
+    } else {
+      LOG_E(LOG_SOURCE_NET, "[startAP] softAP %s failed", apSsid);
     }
     // if DNSServer is started with "*" for domain name, it will reply with
     // provided IP to all DNS request
@@ -1106,11 +1110,6 @@ void setupCoordinatorMode()
   default:
     break;
   }
-  if (!ConfigSettings.disableWeb && (ConfigSettings.coordinator_mode != COORDINATOR_MODE_USB || ConfigSettings.keepWeb))
-  {
-    updWeb = true;
-    Serial.println(F("[MODE] Web server enabled (updWeb=true)"));
-  }
   if (ConfigSettings.coordinator_mode == COORDINATOR_MODE_USB && ConfigSettings.keepWeb)
   {
     Serial.println(F("[MODE] USB+keepWeb: trying connectWifi()"));
@@ -1184,7 +1183,9 @@ void setup()
   //--------------------
 
   // zig connection & leds testing
+  Serial2.setRxBufferSize(BRIDGE_UART_RX_BUFFER); // must be set before begin()
   Serial2.begin(115200, SERIAL_8N1, CC2652P_RXD, CC2652P_TXD); // start zigbee serial
+  bridgeInit();
   zbInit();
   //-----------------
 
@@ -1197,6 +1198,7 @@ void setup()
   }
 
   DEBUG_PRINTLN(F("LITTLEFS OK"));
+  logFileBegin();
   if (!loadSystemVar())
   {
     DEBUG_PRINTLN(F("Error load system vars"));
@@ -1251,7 +1253,7 @@ void setup()
 
   DEBUG_PRINTLN(millis());
 
-  Serial2.updateBaudRate(ConfigSettings.serialSpeed); // set actual speed
+  zbSerialSetup(); // set actual speed and flow control
   printLogMsg("Setup done");
 
   char deviceIdArr[20];
@@ -1271,107 +1273,6 @@ void setup()
   */
 }
 
-WiFiClient client[10];
-
-void socketClientConnected(int client)
-{
-  if (ConfigSettings.connectedSocket[client] != true)
-  {
-    DEBUG_PRINT(F("Connected client "));
-    DEBUG_PRINTLN(client);
-    if (ConfigSettings.connectedClients == 0)
-    {
-      ConfigSettings.socketTime = millis();
-      DEBUG_PRINT(F("Socket time "));
-      DEBUG_PRINTLN(ConfigSettings.socketTime);
-      mqttPublishIo("socket", "ON");
-    }
-    ConfigSettings.connectedSocket[client] = true;
-    ConfigSettings.connectedClients++;
-  }
-}
-
-void socketClientDisconnected(int client)
-{
-  if (ConfigSettings.connectedSocket[client] != false)
-  {
-    DEBUG_PRINT(F("Disconnected client "));
-    DEBUG_PRINTLN(client);
-    ConfigSettings.connectedSocket[client] = false;
-    ConfigSettings.connectedClients--;
-    if (ConfigSettings.connectedClients == 0)
-    {
-      ConfigSettings.socketTime = millis();
-      DEBUG_PRINT(F("Socket time "));
-      DEBUG_PRINTLN(ConfigSettings.socketTime);
-      mqttPublishIo("socket", "OFF");
-    }
-  }
-}
-
-void printRecvSocket(size_t bytes_read, uint8_t net_buf[BUFFER_SIZE])
-{
-  char output_sprintf[2];
-  if (bytes_read > 0)
-  {
-    String tmpTime;
-    String buff = "";
-    unsigned long timeLog = millis();
-    tmpTime = String(timeLog, DEC);
-    logPush('[');
-    for (int j = 0; j < tmpTime.length(); j++)
-    {
-      logPush(tmpTime[j]);
-    }
-    logPush(']');
-    logPush(' ');
-    logPush('-');
-    logPush('>');
-
-    for (int i = 0; i < bytes_read; i++)
-    {
-      sprintf(output_sprintf, "%02x", net_buf[i]);
-      logPush(' ');
-      logPush(output_sprintf[0]);
-      logPush(output_sprintf[1]);
-    }
-    logPush('\n');
-  }
-}
-
-void printSendSocket(size_t bytes_read, uint8_t serial_buf[BUFFER_SIZE])
-{
-  char output_sprintf[2];
-  String tmpTime;
-  String buff = "";
-  unsigned long timeLog = millis();
-  tmpTime = String(timeLog, DEC);
-  logPush('[');
-  for (int j = 0; j < tmpTime.length(); j++)
-  {
-    logPush(tmpTime[j]);
-  }
-  logPush(']');
-  logPush(' ');
-  logPush('<');
-  logPush('-');
-  for (int i = 0; i < bytes_read; i++)
-  {
-    // if (serial_buf[i] == 0x01)
-    //{
-    // }
-    sprintf(output_sprintf, "%02x", serial_buf[i]);
-    logPush(' ');
-    logPush(output_sprintf[0]);
-    logPush(output_sprintf[1]);
-    // if (serial_buf[i] == 0x03)
-    // {
-
-    //}
-  }
-  logPush('\n');
-}
-
 void loop(void)
 {
   if (btnFlag)
@@ -1396,101 +1297,13 @@ void loop(void)
 
   tmrBtnLongPress.update();
   tmrNetworkOverseer.update();
-  if (updWeb)
-  {
-    webServerHandleClient();
-  }
-  else
-  {
-    if (ConfigSettings.connectedClients == 0)
-    {
-      webServerHandleClient();
-    }
-  }
+
+  bridgeLoop();
+  logSerialService();
+  logFileService();
 
   if (ConfigSettings.coordinator_mode != COORDINATOR_MODE_USB)
   {
-    uint16_t net_bytes_read = 0;
-    uint8_t net_buf[BUFFER_SIZE];
-    uint16_t serial_bytes_read = 0;
-    uint8_t serial_buf[BUFFER_SIZE];
-
-    if (server.hasClient())
-    {
-      for (byte i = 0; i < MAX_SOCKET_CLIENTS; i++)
-      {
-        if (!client[i] || !client[i].connected())
-        {
-          if (client[i])
-          {
-            client[i].stop();
-          }
-          if (ConfigSettings.fwEnabled)
-          {
-            WiFiClient TempClient2 = server.available();
-            if (TempClient2.remoteIP() == ConfigSettings.fwIp)
-            {
-              printLogMsg(String("[SOCK IP WHITELIST] Accepted connection from IP: ") + TempClient2.remoteIP().toString());
-              client[i] = TempClient2;
-              continue;
-            }
-            else
-            {
-              printLogMsg(String("[SOCK IP WHITELIST] Rejected connection from unknown IP: ") + TempClient2.remoteIP().toString());
-            }
-          }
-          else
-          {
-            client[i] = server.available();
-            continue;
-          }
-        }
-      }
-      WiFiClient TempClient = server.available();
-      TempClient.stop();
-    }
-
-    for (byte cln = 0; cln < MAX_SOCKET_CLIENTS; cln++)
-    {
-      if (client[cln])
-      {
-        socketClientConnected(cln);
-        while (client[cln].available())
-        { // read from LAN
-          net_buf[net_bytes_read] = client[cln].read();
-          if (net_bytes_read < BUFFER_SIZE - 1)
-            net_bytes_read++;
-        } // send to Zigbee
-        Serial2.write(net_buf, net_bytes_read);
-        // print to web console
-        printRecvSocket(net_bytes_read, net_buf);
-        net_bytes_read = 0;
-      }
-      else
-      {
-        socketClientDisconnected(cln);
-      }
-    }
-
-    if (Serial2.available())
-    {
-      while (Serial2.available())
-      { // read from Zigbee
-        serial_buf[serial_bytes_read] = Serial2.read();
-        if (serial_bytes_read < BUFFER_SIZE - 1)
-          serial_bytes_read++;
-      }
-      // send to LAN
-      for (byte cln = 0; cln < MAX_SOCKET_CLIENTS; cln++)
-      {
-        if (client[cln])
-          client[cln].write(serial_buf, serial_bytes_read);
-      }
-      // print to web console
-      printSendSocket(serial_bytes_read, serial_buf);
-      serial_bytes_read = 0;
-    }
-
     if (MqttSettings.enable)
     {
       mqttLoop();
@@ -12,6 +12,7 @@
 #include "log.h"
 #include "etc.h"
 #include "mqtt.h"
+#include "bridge.h"
 
 extern struct ConfigSettingsStruct ConfigSettings;
 extern struct zbVerStruct zbVer;
@@ -168,6 +169,17 @@ void mqttPublishState()
     MqttSettings.heartbeatTime = millis() + (MqttSettings.interval * 1000);
 }
 
+void mqttPublishBridge()
+{
+    String topic(MqttSettings.topic);
+    topic = topic + "/bridge";
+    DynamicJsonDocument root(2048);
+    bridgeMetrics(root);
+    String mqttBuffer;
+    serializeJson(root, mqttBuffer);
+    mqttPublishMsg(topic, mqttBuffer, false); // streamed, larger than the PubSubClient buffer
+}
+
 void mqttPublishIo(String const &io, String const &state)
 {
     if (clientPubSub.connected())
@@ -250,6 +262,7 @@ void mqttLoop()
             if (MqttSettings.heartbeatTime <= millis())
             {
                 mqttPublishState();
+                mqttPublishBridge();
             }
         }
     }
@@ -4,6 +4,7 @@ void mqttReconnect();
 void mqttCallback(char *topic, byte *payload, unsigned int length);
 void mqttLoop();
 void mqttPublishState();
+void mqttPublishBridge();
 void mqttOnConnect();
 void mqttPublishAvail();
 void mqttPublishDiscovery();
@@ -0,0 +1,98 @@
+#include <string.h>
+
+#include "mt.h"
+
+void mtParserReset(MtParserStruct &parser)
+{ // drop a partial frame, counters are kept
+  if (parser.pos > 0)
+    parser.resyncs++;
+  parser.pos = 0;
+  parser.skipping = false;
+}
+
+bool mtParserBusy(const MtParserStruct &parser)
+{
+  return parser.pos > 0;
+}
+
+uint8_t mtFcs(const uint8_t *buf, size_t len)
+{ // XOR of len, cmd0, cmd1 and payload
+  uint8_t fcs = 0;
+  for (size_t i = 0; i < len; i++)
+  {
+    fcs ^= buf[i];
+  }
+  return fcs;
+}
+
+uint16_t mtParserFeed(MtParserStruct &parser, uint8_t c)
+{ // returns the frame length once parser.frame holds a complete, checked frame
+  if (parser.pos == 0)
+  {
+    if (c != MT_SOF)
+    {
+      if (!parser.skipping)
+      {
+        parser.skipping = true;
+        parser.resyncs++;
+      }
+      return 0;
+    }
+    parser.skipping = false;
+  }
+  parser.frame[parser.pos++] = c;
+  if (parser.pos <= MT_HEADER_LEN)
+    return 0;
+
+  const uint16_t frameLen = MT_HEADER_LEN + parser.frame[1] + 1;
+  if (parser.pos < frameLen)
+    return 0;
+
+  parser.pos = 0;
+  if (mtFcs(parser.frame + 1, frameLen - 2) != parser.frame[frameLen - 1])
+  {
+    parser.badFcs++;
+    parser.resyncs++;
+    return 0;
+  }
+  parser.frames++;
+  return frameLen;
+}
+
+uint32_t mtCountFrames(MtCounterStruct &counter, const uint8_t *buf, size_t len)
+{ // returns the number of frames that ended in buf
+  enum
+  {
+    WAIT_SOF,
+    WAIT_LEN,
+    IN_FRAME
+  };
+  uint32_t frames = 0;
+  for (size_t i = 0; i < len; i++)
+  {
+    switch (counter.state)
+    {
+    case WAIT_SOF:
+      if (buf[i] == MT_SOF)
+        counter.state = WAIT_LEN;
+      break;
+    case WAIT_LEN:
+      counter.remaining = buf[i] + 3; // cmd0, cmd1, payload, FCS
+      counter.state = IN_FRAME;
+      break;
+    default:
+      if (--counter.remaining == 0)
+      {
+        counter.state = WAIT_SOF;
+        frames++;
+      }
+      break;
+    }
+  }
+  return frames;
+}
+
+uint8_t mtType(const uint8_t *frame)
+{ // frame starts with the SOF
+  return frame[2] >> 5;
+}
@@ -0,0 +1,43 @@
+#ifndef MT_H_
+#define MT_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+// TI Monitor & Test (ZNP) UART frame: SOF, len, cmd0, cmd1, payload[len], FCS
+const uint8_t MT_SOF = 0xFE;
+const uint8_t MT_HEADER_LEN = 4; // SOF, len, cmd0, cmd1
+const uint16_t MT_FRAME_MAX = MT_HEADER_LEN + 255 + 1;
+
+enum MT_TYPE_t : uint8_t
+{ // top three bits of cmd0
+  MT_TYPE_POLL,
+  MT_TYPE_SREQ, // synchronous request, answered by exactly one SRSP
+  MT_TYPE_AREQ,
+  MT_TYPE_SRSP
+};
+
+struct MtParserStruct
+{
+  uint8_t frame[MT_FRAME_MAX];
+  uint16_t pos;      // bytes collected, 0 while hunting for SOF
+  bool skipping;     // discarding garbage between frames
+  uint32_t frames;   // good frames
+  uint32_t badFcs;   // frames dropped for a wrong checksum
+  uint32_t resyncs;  // times the parser had to hunt for SOF again
+};
+
+struct MtCounterStruct
+{ // frame counting by structure only, nothing is buffered
+  uint8_t state;
+  uint16_t remaining;
+};
+
+void mtParserReset(MtParserStruct &parser);
+uint16_t mtParserFeed(MtParserStruct &parser, uint8_t c);
+bool mtParserBusy(const MtParserStruct &parser);
+uint32_t mtCountFrames(MtCounterStruct &counter, const uint8_t *buf, size_t len);
+uint8_t mtFcs(const uint8_t *buf, size_t len);
+uint8_t mtType(const uint8_t *frame);
+
+#endif // MT_H_
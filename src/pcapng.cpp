@@ -0,0 +1,67 @@
+#include <string.h>
+
+#include "pcapng.h"
+
+const uint32_t PCAPNG_SHB = 0x0A0D0D0A;
+const uint32_t PCAPNG_IDB = 0x00000001;
+const uint32_t PCAPNG_EPB = 0x00000006;
+const uint32_t PCAPNG_BYTE_ORDER_MAGIC = 0x1A2B3C4D;
+const uint16_t PCAPNG_OPT_END = 0;
+const uint16_t PCAPNG_OPT_EPB_FLAGS = 2;
+
+size_t put16(uint8_t *out, uint16_t v)
+{ // host byte order, the section header's magic tells readers which one
+  memcpy(out, &v, sizeof(v));
+  return sizeof(v);
+}
+
+size_t put32(uint8_t *out, uint32_t v)
+{
+  memcpy(out, &v, sizeof(v));
+  return sizeof(v);
+}
+
+size_t pcapngHeader(uint8_t *out)
+{ // section header block, then one interface with microsecond timestamps (the default if_tsresol)
+  size_t pos = 0;
+  pos += put32(out + pos, PCAPNG_SHB);
+  pos += put32(out + pos, 28);
+  pos += put32(out + pos, PCAPNG_BYTE_ORDER_MAGIC);
+  pos += put16(out + pos, 1); // version 1.0
+  pos += put16(out + pos, 0);
+  pos += put32(out + pos, 0xFFFFFFFF); // section length unknown, it is a stream
+  pos += put32(out + pos, 0xFFFFFFFF);
+  pos += put32(out + pos, 28);
+
+  pos += put32(out + pos, PCAPNG_IDB);
+  pos += put32(out + pos, 20);
+  pos += put16(out + pos, PCAPNG_LINKTYPE_ZNP);
+  pos += put16(out + pos, 0);
+  pos += put32(out + pos, 0); // no snap length limit
+  pos += put32(out + pos, 20);
+  return pos;
+}
+
+size_t pcapngPacket(uint8_t *out, uint64_t timeUs, PCAPNG_DIR_t dir, const uint8_t *data, uint16_t len)
+{ // enhanced packet block on interface 0 with the direction in epb_flags
+  const uint16_t padded = (len + 3) & ~3;
+  const uint32_t total = 32 + padded + 12;
+  size_t pos = 0;
+  pos += put32(out + pos, PCAPNG_EPB);
+  pos += put32(out + pos, total);
+  pos += put32(out + pos, 0);
+  pos += put32(out + pos, (uint32_t)(timeUs >> 32));
+  pos += put32(out + pos, (uint32_t)timeUs);
+  pos += put32(out + pos, len);
+  pos += put32(out + pos, len);
+  memcpy(out + pos, data, len);
+  memset(out + pos + len, 0, padded - len);
+  pos += padded;
+  pos += put16(out + pos, PCAPNG_OPT_EPB_FLAGS);
+  pos += put16(out + pos, 4);
+  pos += put32(out + pos, dir);
+  pos += put16(out + pos, PCAPNG_OPT_END);
+  pos += put16(out + pos, 0);
+  pos += put32(out + pos, total);
+  return pos;
+}
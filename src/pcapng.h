@@ -0,0 +1,22 @@
+#ifndef PCAPNG_H_
+#define PCAPNG_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+// pcapng blocks for the ZNP capture port. There is no registered link type for TI MT frames, so
+// packets go out as LINKTYPE_USER0; tools/znp.lua dissects them in Wireshark.
+const uint16_t PCAPNG_LINKTYPE_ZNP = 147; // LINKTYPE_USER0
+const uint16_t PCAPNG_HEADER_LEN = 28 + 20; // section header + interface description
+const uint16_t PCAPNG_PACKET_OVERHEAD = 32 + 12 + 3; // enhanced packet block, epb_flags, padding
+
+enum PCAPNG_DIR_t : uint8_t
+{
+  PCAPNG_DIR_INBOUND = 1, // coordinator -> gateway
+  PCAPNG_DIR_OUTBOUND = 2 // gateway -> coordinator
+};
+
+size_t pcapngHeader(uint8_t *out);
+size_t pcapngPacket(uint8_t *out, uint64_t timeUs, PCAPNG_DIR_t dir, const uint8_t *data, uint16_t len);
+
+#endif // PCAPNG_H_
@@ -0,0 +1,67 @@
+#include <string.h>
+
+#include "recorder.h"
+#include "mt.h"
+
+void recorderReset(RecorderStruct &rec)
+{
+  rec.head = 0;
+  rec.tail = 0;
+  rec.records = 0;
+  rec.dropped = 0;
+}
+
+uint16_t recorderRecordLen(const RecorderStruct &rec, uint32_t at)
+{ // the MT length byte sits right after the record header and the SOF
+  return RECORDER_RECORD_HEADER + rec.ring[(at + RECORDER_RECORD_HEADER + 1) & (RECORDER_BYTES - 1)] + MT_HEADER_LEN + 1;
+}
+
+void recorderPut(RecorderStruct &rec, const uint8_t *data, size_t len)
+{ // at most two memcpy, one at each side of the wrap
+  const uint32_t at = rec.head & (RECORDER_BYTES - 1);
+  const size_t first = len < (size_t)(RECORDER_BYTES - at) ? len : RECORDER_BYTES - at;
+  memcpy(rec.ring + at, data, first);
+  memcpy(rec.ring, data + first, len - first);
+  rec.head += len;
+}
+
+void recorderAdd(RecorderStruct &rec, uint32_t timeMs, uint8_t dir, const uint8_t *frame, uint16_t len)
+{ // frame must be a complete MT frame as returned by mtParserFeed()
+  const uint16_t need = RECORDER_RECORD_HEADER + len;
+  while (rec.records > 0 && RECORDER_BYTES - (rec.head - rec.tail) < need)
+  {
+    rec.tail += recorderRecordLen(rec, rec.tail);
+    rec.records--;
+    rec.dropped++;
+  }
+  uint8_t header[RECORDER_RECORD_HEADER];
+  memcpy(header, &timeMs, sizeof(timeMs));
+  header[4] = dir;
+  recorderPut(rec, header, sizeof(header));
+  recorderPut(rec, frame, len);
+  rec.records++;
+}
+
+size_t recorderSnapshotSize(const RecorderStruct &rec)
+{
+  return sizeof(RecorderHeaderStruct) + (rec.head - rec.tail);
+}
+
+size_t recorderSnapshot(const RecorderStruct &rec, uint8_t *out, uint32_t uptimeMs, uint64_t wallUs)
+{ // out must hold recorderSnapshotSize() bytes
+  RecorderHeaderStruct header = {};
+  header.magic = RECORDER_MAGIC;
+  header.version = 1;
+  header.headerLen = sizeof(header);
+  header.uptimeMs = uptimeMs;
+  header.records = rec.records;
+  header.dropped = rec.dropped;
+  header.wallUs = wallUs;
+  memcpy(out, &header, sizeof(header));
+  const uint32_t used = rec.head - rec.tail;
+  const uint32_t at = rec.tail & (RECORDER_BYTES - 1);
+  const uint32_t first = used < RECORDER_BYTES - at ? used : RECORDER_BYTES - at;
+  memcpy(out + sizeof(header), rec.ring + at, first);
+  memcpy(out + sizeof(header) + first, rec.ring, used - first);
+  return sizeof(header) + used;
+}
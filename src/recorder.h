@@ -0,0 +1,44 @@
+#ifndef RECORDER_H_
+#define RECORDER_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Flight recorder: the most recent MT frames in a byte ring, oldest overwritten first.
+// Record: u32 time (ms since boot), u8 direction, the frame itself (its length byte says how long).
+// Snapshot: RecorderHeaderStruct followed by the records, oldest first; tools/recorder2pcapng.py converts it.
+// The ring is static DRAM, always there: 8 KB hold about 250 typical frames; builds that can spare
+// the RAM set e.g. -DRECORDER_BYTES=32768 for about 1000.
+#ifndef RECORDER_BYTES
+#define RECORDER_BYTES 8192 // power of two
+#endif
+const uint8_t RECORDER_RECORD_HEADER = 5;
+const uint32_t RECORDER_MAGIC = 0x52504E5A; // "ZNPR"
+
+struct RecorderStruct
+{
+  uint8_t ring[RECORDER_BYTES];
+  uint32_t head;     // free running
+  uint32_t tail;     // free running, start of the oldest record
+  uint32_t records;  // in the ring
+  uint32_t dropped;  // overwritten since boot
+};
+
+struct RecorderHeaderStruct
+{ // little endian, as written by the ESP32
+  uint32_t magic;
+  uint16_t version;
+  uint16_t headerLen;
+  uint32_t uptimeMs; // at snapshot, relates record times to wallUs
+  uint32_t records;
+  uint32_t dropped;
+  uint32_t reserved;
+  uint64_t wallUs;   // at snapshot, 0 if the clock was never set
+};
+
+void recorderReset(RecorderStruct &rec);
+void recorderAdd(RecorderStruct &rec, uint32_t timeMs, uint8_t dir, const uint8_t *frame, uint16_t len);
+size_t recorderSnapshotSize(const RecorderStruct &rec);
+size_t recorderSnapshot(const RecorderStruct &rec, uint8_t *out, uint32_t uptimeMs, uint64_t wallUs);
+
+#endif // RECORDER_H_
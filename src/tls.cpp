@@ -0,0 +1,347 @@
+#include <Arduino.h>
+#include <LittleFS.h>
+#include <lwip/sockets.h>
+#include <new>
+
+#include "mbedtls/ssl.h"
+#include "mbedtls/ssl_ticket.h"
+#include "mbedtls/ssl_cache.h"
+#include "mbedtls/net_sockets.h"
+#include "mbedtls/entropy.h"
+#include "mbedtls/ctr_drbg.h"
+#include "mbedtls/x509_crt.h"
+#include "mbedtls/pk.h"
+#include "mbedtls/ecp.h"
+
+#include "config.h"
+#include "log.h"
+#include "bridge.h"
+#include "tls.h"
+
+extern struct ConfigSettingsStruct ConfigSettings;
+
+const char *tlsCertFile = "/config/tls_cert.pem";
+const char *tlsKeyFile = "/config/tls_key.pem";
+const uint16_t TLS_PEM_MAX = 2048;
+const uint32_t TLS_TICKET_LIFETIME_S = 86400;
+const int tlsCiphersuites[] = { // AES-GCM runs on the AES and SHA accelerators, RSA only for an uploaded RSA certificate
+    MBEDTLS_TLS_ECDHE_ECDSA_WITH_AES_128_GCM_SHA256,
+    MBEDTLS_TLS_ECDHE_RSA_WITH_AES_128_GCM_SHA256,
+    0};
+
+struct TlsSession
+{
+  mbedtls_ssl_context ssl;
+  mbedtls_net_context net; // the WiFiClient's fd, closed by the WiFiClient
+  uint32_t deadline;       // millis() by which the handshake has to be done
+};
+
+TlsStatsStruct TlsStats;
+mbedtls_entropy_context tlsEntropy;
+mbedtls_ctr_drbg_context tlsDrbg;
+mbedtls_ssl_config tlsConf;
+mbedtls_x509_crt tlsCert;
+mbedtls_pk_context tlsKey;
+mbedtls_ssl_ticket_context tlsTicket;
+mbedtls_ssl_cache_context tlsCache;
+TlsSession *tlsSlot[MAX_SOCKET_CLIENTS];
+bool tlsReady = false;
+bool tlsResuming = false; // set by the ticket and cache lookups of the running handshake
+
+int tlsTicketParse(void *ticket, mbedtls_ssl_session *session, unsigned char *buf, size_t len)
+{ // mbedTLS has no "was resumed" query, a ticket that parses means an abbreviated handshake
+  const int ret = mbedtls_ssl_ticket_parse(ticket, session, buf, len);
+  tlsResuming |= ret == 0;
+  return ret;
+}
+
+int tlsCacheGet(void *cache, mbedtls_ssl_session *session)
+{
+  const int ret = mbedtls_ssl_cache_get(cache, session);
+  tlsResuming |= ret == 0;
+  return ret;
+}
+
+int tlsWriteFile(const char *path, const unsigned char *pem)
+{
+  File file = LittleFS.open(path, FILE_WRITE);
+  if (!file)
+    return -1;
+  const size_t len = strlen((const char *)pem);
+  const size_t put = file.write(pem, len);
+  file.close();
+  return put == len ? 0 : -1;
+}
+
+unsigned char *tlsReadFile(const char *path, size_t &len)
+{ // NUL terminated, the PEM parsers count it in len
+  File file = LittleFS.open(path, FILE_READ);
+  if (!file)
+    return NULL;
+  len = file.size();
+  unsigned char *pem = (unsigned char *)malloc(len + 1);
+  if (pem)
+  {
+    file.read(pem, len);
+    pem[len++] = '\0';
+  }
+  file.close();
+  return pem;
+}
+
+bool tlsCreateCert()
+{ // self-signed ECDSA P-256, created once on first start
+#ifdef MBEDTLS_X509_CRT_WRITE_C
+  LOG_I(LOG_SOURCE_NET, "[TLS] Creating a self-signed certificate");
+  mbedtls_pk_context key;
+  mbedtls_x509write_cert crt;
+  mbedtls_mpi serial;
+  mbedtls_pk_init(&key);
+  mbedtls_x509write_crt_init(&crt);
+  mbedtls_mpi_init(&serial);
+  const String subject = String("CN=") + ConfigSettings.hostname + ",O=AVATTO";
+  unsigned char *pem = (unsigned char *)malloc(TLS_PEM_MAX);
+  int ret = pem ? mbedtls_pk_setup(&key, mbedtls_pk_info_from_type(MBEDTLS_PK_ECKEY)) : MBEDTLS_ERR_PK_ALLOC_FAILED;
+  if (!ret)
+    ret = mbedtls_ecp_gen_key(MBEDTLS_ECP_DP_SECP256R1, mbedtls_pk_ec(key), mbedtls_ctr_drbg_random, &tlsDrbg);
+  if (!ret)
+    ret = mbedtls_mpi_fill_random(&serial, 8, mbedtls_ctr_drbg_random, &tlsDrbg);
+  if (!ret)
+  {
+    mbedtls_x509write_crt_set_version(&crt, MBEDTLS_X509_CRT_VERSION_3);
+    mbedtls_x509write_crt_set_md_alg(&crt, MBEDTLS_MD_SHA256);
+    mbedtls_x509write_crt_set_subject_key(&crt, &key);
+    mbedtls_x509write_crt_set_issuer_key(&crt, &key);
+    ret = mbedtls_x509write_crt_set_subject_name(&crt, subject.c_str());
+  }
+  if (!ret)
+    ret = mbedtls_x509write_crt_set_issuer_name(&crt, subject.c_str());
+  if (!ret)
+    ret = mbedtls_x509write_crt_set_serial(&crt, &serial);
+  if (!ret)
+    ret = mbedtls_x509write_crt_set_validity(&crt, "20240101000000", "20491231235959");
+  if (!ret)
+    ret = mbedtls_x509write_crt_set_basic_constraints(&crt, 0, -1);
+  if (!ret)
+    ret = mbedtls_x509write_crt_pem(&crt, pem, TLS_PEM_MAX, mbedtls_ctr_drbg_random, &tlsDrbg);
+  if (!ret)
+    ret = tlsWriteFile(tlsCertFile, pem);
+  if (!ret)
+    ret = mbedtls_pk_write_key_pem(&key, pem, TLS_PEM_MAX);
+  if (!ret)
+    ret = tlsWriteFile(tlsKeyFile, pem);
+  free(pem);
+  mbedtls_mpi_free(&serial);
+  mbedtls_x509write_crt_free(&crt);
+  mbedtls_pk_free(&key);
+  if (ret)
+    LOG_E(LOG_SOURCE_NET, "[TLS] Certificate creation failed: -0x%x", -ret);
+  return ret == 0;
+#else
+  LOG_E(LOG_SOURCE_NET, "[TLS] No certificate, upload %s and %s", tlsCertFile, tlsKeyFile);
+  return false;
+#endif
+}
+
+bool tlsLoadCert()
+{
+  size_t len;
+  unsigned char *pem = tlsReadFile(tlsCertFile, len);
+  int ret = pem ? mbedtls_x509_crt_parse(&tlsCert, pem, len) : -1;
+  free(pem);
+  if (!ret)
+  {
+    pem = tlsReadFile(tlsKeyFile, len);
+    ret = pem ? mbedtls_pk_parse_key(&tlsKey, pem, len, NULL, 0) : -1;
+    free(pem);
+  }
+  return ret == 0;
+}
+
+bool tlsInit()
+{ // once, from the TLS task, the key generation may take a while
+  if (tlsReady)
+    return true;
+  mbedtls_entropy_init(&tlsEntropy);
+  mbedtls_ctr_drbg_init(&tlsDrbg);
+  mbedtls_ssl_config_init(&tlsConf);
+  mbedtls_x509_crt_init(&tlsCert);
+  mbedtls_pk_init(&tlsKey);
+  mbedtls_ssl_ticket_init(&tlsTicket);
+  mbedtls_ssl_cache_init(&tlsCache);
+  int ret = mbedtls_ctr_drbg_seed(&tlsDrbg, mbedtls_entropy_func, &tlsEntropy, (const unsigned char *)ConfigSettings.hostname, strlen(ConfigSettings.hostname));
+  if (ret)
+  {
+    LOG_E(LOG_SOURCE_NET, "[TLS] RNG seed failed: -0x%x", -ret);
+    return false;
+  }
+  if (!tlsLoadCert())
+  {
+    mbedtls_x509_crt_free(&tlsCert);
+    mbedtls_pk_free(&tlsKey);
+    mbedtls_x509_crt_init(&tlsCert);
+    mbedtls_pk_init(&tlsKey);
+    if (!tlsCreateCert() || !tlsLoadCert())
+    {
+      LOG_E(LOG_SOURCE_NET, "[TLS] No usable certificate, TLS port disabled");
+      return false;
+    }
+  }
+  ret = mbedtls_ssl_config_defaults(&tlsConf, MBEDTLS_SSL_IS_SERVER, MBEDTLS_SSL_TRANSPORT_STREAM, MBEDTLS_SSL_PRESET_DEFAULT);
+  if (!ret)
+    ret = mbedtls_ssl_conf_own_cert(&tlsConf, &tlsCert, &tlsKey);
+  if (!ret)
+    ret = mbedtls_ssl_ticket_setup(&tlsTicket, mbedtls_ctr_drbg_random, &tlsDrbg, MBEDTLS_CIPHER_AES_128_GCM, TLS_TICKET_LIFETIME_S);
+  if (ret)
+  {
+    LOG_E(LOG_SOURCE_NET, "[TLS] Setup failed: -0x%x", -ret);
+    return false;
+  }
+  mbedtls_ssl_conf_rng(&tlsConf, mbedtls_ctr_drbg_random, &tlsDrbg);
+  mbedtls_ssl_conf_authmode(&tlsConf, MBEDTLS_SSL_VERIFY_NONE); // clients are vetted by the allow-list
+  mbedtls_ssl_conf_min_version(&tlsConf, MBEDTLS_SSL_MAJOR_VERSION_3, MBEDTLS_SSL_MINOR_VERSION_3);
+  mbedtls_ssl_conf_ciphersuites(&tlsConf, tlsCiphersuites);
+  mbedtls_ssl_conf_read_timeout(&tlsConf, BRIDGE_TLS_HANDSHAKE_MS);
+  mbedtls_ssl_conf_session_tickets_cb(&tlsConf, mbedtls_ssl_ticket_write, tlsTicketParse, &tlsTicket);
+  mbedtls_ssl_cache_set_max_entries(&tlsCache, BRIDGE_TLS_MAX * 2);
+  mbedtls_ssl_cache_set_timeout(&tlsCache, TLS_TICKET_LIFETIME_S);
+  mbedtls_ssl_conf_session_cache(&tlsConf, &tlsCache, tlsCacheGet, mbedtls_ssl_cache_set);
+  tlsReady = true;
+  return true;
+}
+
+int tlsHandshakeSend(void *ctx, const unsigned char *buf, size_t len)
+{
+  TlsSession *tls = (TlsSession *)ctx;
+  if ((int32_t)(millis() - tls->deadline) >= 0)
+    return MBEDTLS_ERR_SSL_TIMEOUT;
+  return mbedtls_net_send(&tls->net, buf, len);
+}
+
+int tlsHandshakeRecv(void *ctx, unsigned char *buf, size_t len, uint32_t timeout)
+{ // the read timeout shrinks to what is left of the handshake, a peer trickling bytes runs out too
+  TlsSession *tls = (TlsSession *)ctx;
+  const int32_t left = tls->deadline - millis();
+  if (left <= 0)
+    return MBEDTLS_ERR_SSL_TIMEOUT;
+  return mbedtls_net_recv_timeout(&tls->net, buf, len, min(timeout, (uint32_t)left));
+}
+
+TlsSession *tlsHandshake(int fd)
+{ // blocking, the whole handshake bounded by BRIDGE_TLS_HANDSHAKE_MS; NULL on failure
+  TlsSession *tls = new (std::nothrow) TlsSession;
+  if (!tls)
+    return NULL;
+  mbedtls_ssl_init(&tls->ssl);
+  tls->net.fd = fd;
+  tlsResuming = false;
+  const uint32_t start = millis();
+  tls->deadline = start + BRIDGE_TLS_HANDSHAKE_MS;
+  int ret = mbedtls_ssl_setup(&tls->ssl, &tlsConf);
+  if (!ret)
+  {
+    struct timeval timeout = {BRIDGE_TLS_HANDSHAKE_MS / 1000, 0};
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+    mbedtls_net_set_block(&tls->net);
+    mbedtls_ssl_set_bio(&tls->ssl, tls, tlsHandshakeSend, NULL, tlsHandshakeRecv);
+    while ((ret = mbedtls_ssl_handshake(&tls->ssl)) == MBEDTLS_ERR_SSL_WANT_READ || ret == MBEDTLS_ERR_SSL_WANT_WRITE)
+    {
+      if (millis() - start > BRIDGE_TLS_HANDSHAKE_MS)
+      {
+        ret = MBEDTLS_ERR_SSL_TIMEOUT;
+        break;
+      }
+    }
+    timeout = {0, 0}; // bridge I/O is non-blocking from here on
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+  }
+  if (ret)
+  {
+    bridgeLock();
+    TlsStats.failed++;
+    bridgeUnlock();
+    LOG_W(LOG_SOURCE_NET, "[TLS] Handshake failed: -0x%x", -ret);
+    tlsFree(tls);
+    return NULL;
+  }
+  const uint32_t ms = millis() - start;
+  bridgeLock(); // read by bridgeMetrics()
+  if (tlsResuming)
+  {
+    TlsStats.resumed++;
+    TlsStats.resumedMs += ms;
+    TlsStats.lastResumedMs = ms;
+  }
+  else
+  {
+    TlsStats.full++;
+    TlsStats.fullMs += ms;
+    TlsStats.lastFullMs = ms;
+  }
+  bridgeUnlock();
+  LOG_I(LOG_SOURCE_NET, "[TLS] %s handshake in %lu ms, %s", tlsResuming ? "Resumed" : "Full", (unsigned long)ms,
+        mbedtls_ssl_get_ciphersuite(&tls->ssl));
+  return tls;
+}
+
+void tlsAttach(uint8_t cln, TlsSession *tls)
+{ // from now on driven by the bridge core, never blocks
+  mbedtls_net_set_nonblock(&tls->net);
+  mbedtls_ssl_set_bio(&tls->ssl, &tls->net, mbedtls_net_send, mbedtls_net_recv, NULL);
+  tlsSlot[cln] = tls;
+}
+
+void tlsFree(TlsSession *tls)
+{
+  mbedtls_ssl_free(&tls->ssl);
+  delete tls;
+}
+
+void tlsClose(uint8_t cln)
+{ // close_notify if the socket takes it right away, the fd stays with the WiFiClient
+  if (!tlsSlot[cln])
+    return;
+  mbedtls_ssl_close_notify(&tlsSlot[cln]->ssl);
+  tlsFree(tlsSlot[cln]);
+  tlsSlot[cln] = NULL;
+}
+
+bool tlsActive(uint8_t cln)
+{
+  return tlsSlot[cln] != NULL;
+}
+
+uint8_t tlsCount()
+{
+  uint8_t count = 0;
+  for (uint8_t cln = 0; cln < MAX_SOCKET_CLIENTS; cln++)
+  {
+    count += tlsSlot[cln] != NULL;
+  }
+  return count;
+}
+
+int tlsErrno(int ret)
+{ // mbedTLS result -> recv()/send() result
+  if (ret >= 0)
+    return ret;
+  errno = (ret == MBEDTLS_ERR_SSL_WANT_READ || ret == MBEDTLS_ERR_SSL_WANT_WRITE) ? EAGAIN : ECONNRESET;
+  return -1;
+}
+
+int tlsRecv(uint8_t cln, uint8_t *buf, size_t len)
+{ // one record at most, a partly read record is reported as a full buffer so the core reads on
+  const int ret = mbedtls_ssl_read(&tlsSlot[cln]->ssl, buf, len);
+  return ret == MBEDTLS_ERR_SSL_PEER_CLOSE_NOTIFY ? 0 : tlsErrno(ret);
+}
+
+int tlsSend(uint8_t cln, const uint8_t *buf, size_t len)
+{ // after EAGAIN mbedTLS wants the same buffer again; the core retries the unchanged queue front
+  return tlsErrno(mbedtls_ssl_write(&tlsSlot[cln]->ssl, buf, len));
+}
+
+size_t tlsRecordOverhead(uint8_t cln)
+{ // header, explicit nonce and tag added to every write
+  const int expansion = tlsSlot[cln] ? mbedtls_ssl_get_record_expansion(&tlsSlot[cln]->ssl) : 0;
+  return expansion > 0 ? expansion : 0;
+}
@@ -0,0 +1,40 @@
+#ifndef TLS_H_
+#define TLS_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+// TLS 1.2 server side of the bridge, mbedTLS. Handshakes run in bridgeTlsTask() without the bridge
+// lock; the established session is attached to a client slot and read/written by the bridge core
+// through bridgeClientRecv()/bridgeClientSend(). Session tickets (and a small session cache for
+// clients without ticket support) let a reconnecting client skip the ECDHE and certificate steps.
+// The certificate is /config/tls_cert.pem with /config/tls_key.pem, a self-signed P-256 pair is
+// created on first use.
+
+struct TlsSession;
+
+struct TlsStatsStruct
+{
+  uint32_t full;        // complete handshakes
+  uint32_t resumed;     // abbreviated handshakes, ticket or cache
+  uint32_t failed;
+  uint32_t fullMs;      // sum over the complete handshakes
+  uint32_t resumedMs;   // sum over the abbreviated ones
+  uint32_t lastFullMs;
+  uint32_t lastResumedMs;
+};
+
+extern TlsStatsStruct TlsStats;
+
+bool tlsInit();
+TlsSession *tlsHandshake(int fd);
+void tlsAttach(uint8_t cln, TlsSession *tls);
+void tlsFree(TlsSession *tls);
+void tlsClose(uint8_t cln);
+bool tlsActive(uint8_t cln);
+uint8_t tlsCount();
+int tlsRecv(uint8_t cln, uint8_t *buf, size_t len);
+int tlsSend(uint8_t cln, const uint8_t *buf, size_t len);
+size_t tlsRecordOverhead(uint8_t cln);
+
+#endif // TLS_H_
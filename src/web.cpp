@@ -9,12 +9,18 @@
 #include <FS.h>
 #include <WiFi.h>
 #include <Ticker.h>
+#include <lwip/sockets.h>
 
 #include "config.h"
 #include "web.h"
 #include "log.h"
+#include "logfile.h"
+#include "logexport.h"
 #include "etc.h"
 #include "zb.h"
+#include "bridge.h"
+#include "mt.h"
+#include "tls.h"
 #include "zones.h"
 
 #include "webh/PAGE_WG.html.gz.h"
@@ -98,6 +104,8 @@ extern struct ConfigSettingsStruct ConfigSettings;
 extern struct zbVerStruct zbVer;
 extern struct MqttSettingsStruct MqttSettings;
 extern struct WgSettingsStruct WgSettings;
+extern struct BridgeStatsStruct BridgeStats;
+extern struct MtParserStruct MtParser;
 
 bool wifiWebSetupInProgress = false;
 extern const char *coordMode;
@@ -118,6 +126,7 @@ const char *respHeaderName = "respValuesArr";
 const char *respTimeZonesName = "respTimeZones";
 const char *contTypeJson = "application/json";
 const char *contTypeText = "text/plain";
+const char *contTypeBinary = "application/octet-stream";
 
 const char *tempFile = "/config/fw.hex";
 
@@ -146,11 +155,44 @@ WebServer serverWeb(80);
 // HTTPClient clientWeb;
 WiFiClient eventsClient;
 
+struct LogStreamStruct
+{ // a browser tailing the log over /events?log
+    WiFiClient client;
+    bool active;
+    uint32_t seq;       // last log record taken into out
+    String out;         // events not yet accepted by the socket
+    size_t sent;
+    uint32_t lastWrite; // millis()
+};
+LogStreamStruct logStreams[WEB_LOG_STREAMS];
+uint32_t logStreamBridgeAt = 0;
+uint32_t logStreamBridgeBytes = 0;
+
+SemaphoreHandle_t webMutex = NULL;
+TaskHandle_t webTaskHandle = NULL;
+uint32_t pingDeadline = 0; // millis() after which a ping benchmark is stopped by API_PING_RESULT
+bool pingRan = false;
+bool pingCollected = false; // pingResult holds the last run, its samples are freed
+bool pingComplete = false;
+BridgePingResultStruct pingResult;
+
 void webServerHandleClient()
 {
     serverWeb.handleClient();
 }
 
+void webServerTask(void *param)
+{ // serves HTTP next to the socket bridge, also while socket clients are connected
+    for (;;)
+    {
+        xSemaphoreTake(webMutex, portMAX_DELAY);
+        webServerHandleClient();
+        xSemaphoreGive(webMutex);
+        logStreamService();
+        vTaskDelay(1);
+    }
+}
+
 void checkFwHexTask(void *param)
 {
     const char *tempFile = static_cast<const char *>(param);
@@ -163,6 +205,11 @@ void checkFwHexTask(void *param)
 
 void initWebServer()
 {
+    if (!webMutex)
+    {
+        webMutex = xSemaphoreCreateMutex();
+    }
+    xSemaphoreTake(webMutex, portMAX_DELAY); // called again on reconnects while the web task runs
     serverWeb.on("/js/bootstrap.min.js", []()
                  { sendGzip(contTypeTextJs, bootstrap_min_js_gz, bootstrap_min_js_gz_len); });
     serverWeb.on("/js/masonry.js", []()
@@ -458,25 +505,155 @@ void initWebServer()
             }
         });
 
-    const char *headerkeys[] = {"Content-Length"};
+    const char *headerkeys[] = {"Content-Length", "Last-Event-ID"};
     size_t headerkeyssize = sizeof(headerkeys) / sizeof(char *);
     serverWeb.collectHeaders(headerkeys, headerkeyssize);
     serverWeb.begin();
+    xSemaphoreGive(webMutex);
+    if (!webTaskHandle)
+    {
+        xTaskCreate(webServerTask, "web", WEB_TASK_STACK, NULL, WEB_TASK_PRIORITY, &webTaskHandle);
+    }
     DEBUG_PRINTLN(F("webserver setup done"));
 }
 
+void sendEventHeader(WiFiClient &client)
+{
+    client.println("HTTP/1.1 200 OK");
+    client.println("Content-Type: text/event-stream;");
+    client.println("Connection: close");
+    client.println("Access-Control-Allow-Origin: *");
+    client.println("Cache-Control: no-cache");
+    client.println();
+    client.flush();
+}
+
+void logStreamOpen()
+{ // EventSource reconnects with Last-Event-ID, the stream resumes after the last record it got
+    const char *lastId = "Last-Event-ID";
+    int slot = -1;
+    for (uint8_t i = 0; i < WEB_LOG_STREAMS; i++)
+    {
+        if (logStreams[i].active && !logStreams[i].client.connected())
+        {
+            logStreams[i].client.stop();
+            logStreams[i].active = false;
+        }
+        if (!logStreams[i].active && slot < 0)
+            slot = i;
+    }
+    if (slot < 0)
+    {
+        serverWeb.send(HTTP_CODE_SERVICE_UNAVAILABLE, contTypeText, "too many log streams");
+        return;
+    }
+    LogStreamStruct &stream = logStreams[slot];
+    stream.client = serverWeb.client();
+    sendEventHeader(stream.client);
+    stream.seq = serverWeb.hasHeader(lastId) ? strtoul(serverWeb.header(lastId).c_str(), nullptr, 10) : 0;
+    stream.out = "retry: 2000\n\n";
+    if (stream.seq > logLastSeq())
+    { // gateway restarted since, the browser starts over
+        stream.seq = 0;
+        stream.out += "event: reset\ndata: \n\n";
+    }
+    stream.sent = 0;
+    stream.lastWrite = millis();
+    stream.active = true;
+}
+
+String bridgeEvent()
+{ // traffic summary, only when something moved
+    StaticJsonDocument<256> doc;
+    const char *dirs[] = {"zbToNet", "netToZb"};
+    bridgeLock();
+    const uint32_t bytes = BridgeStats.dir[0].bytes + BridgeStats.dir[1].bytes;
+    for (uint8_t i = 0; i < 2; i++)
+    {
+        JsonObject dir = doc.createNestedObject(dirs[i]);
+        dir["bytes"] = BridgeStats.dir[i].bytes;
+        dir["frames"] = BridgeStats.dir[i].frames;
+    }
+    doc["writeStalls"] = BridgeStats.writeStalls;
+    bridgeUnlock();
+    if (bytes == logStreamBridgeBytes)
+        return String();
+    logStreamBridgeBytes = bytes;
+    doc["clients"] = ConfigSettings.connectedClients;
+    String event = "event: bridge\ndata: ";
+    serializeJson(doc, event);
+    event += "\n\n";
+    return event;
+}
+
+void logStreamService()
+{ // never waits for a browser: what a slow one cannot take yet stays in the log ring, where the
+  // oldest lines are overwritten and reported as lost; the bridge only ever writes to the ring
+    bool any = false;
+    for (uint8_t i = 0; i < WEB_LOG_STREAMS; i++)
+        any |= logStreams[i].active;
+    if (!any)
+        return;
+    String bridge;
+    if (millis() - logStreamBridgeAt >= 1000)
+    {
+        logStreamBridgeAt = millis();
+        bridge = bridgeEvent();
+    }
+    for (uint8_t i = 0; i < WEB_LOG_STREAMS; i++)
+    {
+        LogStreamStruct &stream = logStreams[i];
+        if (!stream.active)
+            continue;
+        if (stream.sent == stream.out.length())
+        { // previous events fully taken, collect the next ones
+            stream.out = "";
+            stream.sent = 0;
+            uint32_t last, lost;
+            String text = logPrintSince(stream.seq, last, lost);
+            if (lost)
+                stream.out += "event: lost\ndata: " + String(lost) + "\n\n";
+            if (text.length())
+            { // one event per batch, every line a data line
+                text.remove(text.length() - 1);
+                text.replace("\n", "\ndata: ");
+                stream.out += "id: " + String(last) + "\nevent: log\ndata: " + text + "\n\n";
+            }
+            stream.seq = last;
+            stream.out += bridge;
+            if (!stream.out.length() && millis() - stream.lastWrite > 15000)
+                stream.out = ":\n\n"; // keepalive comment, finds closed browsers
+        }
+        if (stream.sent < stream.out.length())
+        {
+            const int n = send(stream.client.fd(), stream.out.c_str() + stream.sent, stream.out.length() - stream.sent, MSG_DONTWAIT);
+            if (n > 0)
+            {
+                stream.sent += n;
+                stream.lastWrite = millis();
+            }
+            else if (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK)
+            {
+                stream.client.stop();
+                stream.active = false;
+                stream.out = "";
+                stream.sent = 0;
+            }
+        }
+    }
+}
+
 void handleEvents()
 {
+    if (serverWeb.hasArg("log"))
+    {
+        logStreamOpen();
+        return;
+    }
     eventsClient = serverWeb.client();
     if (eventsClient)
     { // send events header
-        eventsClient.println("HTTP/1.1 200 OK");
-        eventsClient.println("Content-Type: text/event-stream;");
-        eventsClient.println("Connection: close");
-        eventsClient.println("Access-Control-Allow-Origin: *");
-        eventsClient.println("Cache-Control: no-cache");
-        eventsClient.println();
-        eventsClient.flush();
+        sendEventHeader(eventsClient);
     }
 }
 
@@ -536,7 +713,14 @@ void handleApi()
         API_WIFICONNECTSTAT,
         API_CMD,
         API_GET_LOG,
-        API_FLASH_ZB
+        API_FLASH_ZB,
+        API_GET_BRIDGE,
+        API_PROBE_BAUD,
+        API_GET_METRICS,
+        API_GET_RECORDER,
+        API_PING_BENCH,
+        API_GET_LOG_HISTORY,
+        API_PING_RESULT
     };
     const char *action = "action";
     const char *page = "page";
@@ -636,10 +820,232 @@ void handleApi()
             ConfigSettings.zbFlashing = 0;
         }
         break;
-        case API_GET_LOG:
+        case API_GET_BRIDGE:
+        {
+            const char *reset = "reset";
+            const char *modes[] = {"loop", "task"};
+            String result;
+            DynamicJsonDocument doc(2048);
+            doc["mode"] = modes[ConfigSettings.bridgeMode];
+            bridgeLock(); // snapshot and reset against the bridge task, serialized after the unlock
+            for (uint8_t i = 0; i < 2; i++)
+            { // UART rx event -> TCP write latency, per bridge mode
+                const BridgeLatencyStruct &lat = BridgeStats.latency[i];
+                JsonObject obj = doc.createNestedObject(modes[i]);
+                obj["samples"] = lat.samples;
+                obj["minUs"] = lat.minUs;
+                obj["avgUs"] = lat.samples ? (uint32_t)(lat.sumUs / lat.samples) : 0;
+                obj["maxUs"] = lat.maxUs;
+            }
+            JsonArray clients = doc.createNestedArray("clients");
+            for (uint8_t i = 0; i < MAX_SOCKET_CLIENTS; i++)
+            {
+                const BridgeClientStatsStruct &cls = BridgeStats.client[i];
+                JsonObject obj = clients.createNestedObject();
+                obj["connected"] = ConfigSettings.connectedSocket[i];
+                obj["role"] = bridgeClientRole(i) == CLIENT_ROLE_PRIMARY ? "primary" : "monitor";
+                obj["pending"] = bridgeClientPending(i);
+                obj["queued"] = cls.queued;
+                obj["drops"] = cls.drops;
+                obj["evictions"] = cls.evictions;
+                obj["rxDropped"] = cls.rxDropped;
+                obj["timeouts"] = cls.timeouts;
+                if (tlsActive(i))
+                { // record header, explicit nonce and tag on every write to this client
+                    obj["tlsOverhead"] = tlsRecordOverhead(i);
+                }
+            }
+            doc["poolFree"] = bridgePoolFree();
+            doc["poolExhausted"] = BridgeStats.poolExhausted;
+            doc["logSkipped"] = BridgeStats.logSkipped;
+            const char *policies[] = {"immediate", "batch", "frame"};
+            JsonObject coalesce = doc.createNestedObject("coalesce");
+            coalesce["policy"] = policies[ConfigSettings.bridgeCoalesce];
+            coalesce["us"] = ConfigSettings.coalesceUs;
+            coalesce["bytes"] = ConfigSettings.coalesceBytes;
+            JsonObject mt = doc.createNestedObject("mt");
+            mt["frames"] = MtParser.frames;
+            mt["badFcs"] = MtParser.badFcs;
+            mt["resyncs"] = MtParser.resyncs;
+            if (serverWeb.hasArg(reset))
+            {
+                bridgeStatsReset();
+            }
+            bridgeUnlock();
+            serializeJson(doc, result);
+            serverWeb.send(HTTP_CODE_OK, contTypeJson, result);
+        }
+        break;
+        case API_GET_METRICS:
         {
             String result;
-            result = logPrint();
+            DynamicJsonDocument doc(2048);
+            bridgeMetrics(doc);
+            JsonObject logExport = doc.createNestedObject("logExport");
+            logExport["records"] = LogExportStats.records;
+            logExport["datagrams"] = LogExportStats.datagrams;
+            logExport["dropped"] = LogExportStats.dropped;
+            logExport["resolveFailures"] = LogExportStats.resolveFailures;
+            serializeJson(doc, result);
+            serverWeb.send(HTTP_CODE_OK, contTypeJson, result);
+        }
+        break;
+        case API_GET_RECORDER:
+        { // flight recorder snapshot, copied under the bridge lock and sent without it
+            bridgeLock();
+            const size_t len = recorderSnapshotSize(FlightRecorder);
+            uint8_t *snapshot = (uint8_t *)malloc(len);
+            if (snapshot)
+            {
+                const uint64_t wallUs = bridgeTimeUs();
+                recorderSnapshot(FlightRecorder, snapshot, millis(), wallUs > 1600000000ULL * 1000000 ? wallUs : 0);
+            }
+            bridgeUnlock();
+            if (!snapshot)
+            {
+                serverWeb.send(HTTP_CODE_INTERNAL_SERVER_ERROR, contTypeText, "out of memory");
+                return;
+            }
+            serverWeb.sendHeader("Content-Disposition", "attachment; filename=\"znp-recorder.bin\"");
+            serverWeb.setContentLength(len);
+            serverWeb.send(HTTP_CODE_OK, contTypeBinary, "");
+            serverWeb.sendContent((const char *)snapshot, len);
+            free(snapshot);
+        }
+        break;
+        case API_PING_BENCH:
+        { // SYS_PING round trips, sent by the bridge between the primary client's own requests; the run is
+          // started here and collected with API_PING_RESULT, the web task does not wait for it
+            const char *count = "count";
+            const char *timeout = "timeout";
+            if (ConfigSettings.coordinator_mode == COORDINATOR_MODE_USB)
+            {
+                serverWeb.send(HTTP_CODE_CONFLICT, contTypeText, "coordinator is on USB");
+                return;
+            }
+            const uint16_t pings = constrain(serverWeb.hasArg(count) ? serverWeb.arg(count).toInt() : 100, 1, BRIDGE_PING_MAX);
+            const uint16_t timeoutMs = constrain(serverWeb.hasArg(timeout) ? serverWeb.arg(timeout).toInt() : 500, 10, 5000);
+            bridgeLock();
+            const bool started = bridgePingStart(pings, timeoutMs);
+            const bool busy = bridgePingBusy();
+            bridgeUnlock();
+            if (!started)
+            {
+                serverWeb.send(HTTP_CODE_CONFLICT, contTypeText, busy ? "benchmark already running" : "benchmark busy or out of memory");
+                return;
+            }
+            pingCollected = false;
+            pingDeadline = millis() + (uint32_t)pings * (timeoutMs + BRIDGE_SREQ_TIMEOUT_MS) + 1000;
+            pingRan = true;
+            String result;
+            DynamicJsonDocument doc(128);
+            doc["count"] = pings;
+            doc["timeoutMs"] = timeoutMs;
+            doc["maxMs"] = pingDeadline - millis();
+            serializeJson(doc, result);
+            serverWeb.send(HTTP_CODE_ACCEPTED, contTypeJson, result);
+        }
+        break;
+        case API_PING_RESULT:
+        { // 202 while the benchmark runs, its figures once it is done
+            if (!pingRan)
+            {
+                serverWeb.send(HTTP_CODE_NOT_FOUND, contTypeText, "no benchmark run");
+                return;
+            }
+            if (!pingCollected)
+            {
+                bridgeLock();
+                bool busy = bridgePingBusy();
+                pingComplete = true;
+                if (busy && (int32_t)(millis() - pingDeadline) >= 0)
+                { // bridge not serviced, report what was done
+                    bridgePingStop();
+                    busy = false;
+                    pingComplete = false;
+                }
+                if (!busy)
+                    bridgePingResult(pingResult); // frees the samples
+                bridgeUnlock();
+                if (busy)
+                {
+                    serverWeb.send(HTTP_CODE_ACCEPTED, contTypeText, "running");
+                    return;
+                }
+                pingCollected = true;
+            }
+
+            String result;
+            DynamicJsonDocument doc(256);
+            doc["count"] = pingResult.sent;
+            doc["answered"] = pingResult.answered;
+            doc["loss"] = pingResult.sent ? 100.0 * (pingResult.sent - pingResult.answered) / pingResult.sent : 0;
+            doc["minUs"] = pingResult.minUs;
+            doc["p50Us"] = pingResult.p50Us;
+            doc["p99Us"] = pingResult.p99Us;
+            doc["maxUs"] = pingResult.maxUs;
+            doc["complete"] = pingComplete;
+            serializeJson(doc, result);
+            serverWeb.send(HTTP_CODE_OK, contTypeJson, result);
+        }
+        break;
+        case API_PROBE_BAUD:
+        { // retunes Serial2, so not under a client that is talking to the coordinator
+            const char *save = "save";
+            for (uint8_t i = 0; i < MAX_SOCKET_CLIENTS; i++)
+            {
+                if (ConfigSettings.connectedSocket[i] && bridgeClientRole(i) == CLIENT_ROLE_PRIMARY)
+                {
+                    serverWeb.send(HTTP_CODE_CONFLICT, contTypeText, "disconnect the primary client first");
+                    return;
+                }
+            }
+            String result;
+            DynamicJsonDocument doc(128);
+            const uint32_t baud = zbProbeBaud();
+            doc["baud"] = baud;
+            if (baud && serverWeb.hasArg(save))
+            {
+                DynamicJsonDocument config(1024);
+                File configFile = LittleFS.open(configFileSerial, FILE_READ);
+                deserializeJson(config, configFile);
+                configFile.close();
+                config["baud"] = baud;
+                configFile = LittleFS.open(configFileSerial, FILE_WRITE);
+                serializeJson(config, configFile);
+                configFile.close();
+                ConfigSettings.serialSpeed = baud;
+            }
+            serializeJson(doc, result);
+            serverWeb.send(HTTP_CODE_OK, contTypeJson, result);
+        }
+        break;
+        case API_GET_LOG_HISTORY:
+        { // flash segments, oldest first, streamed a record at a time
+            serverWeb.sendHeader("Content-Disposition", "attachment; filename=\"gateway-log.txt\"");
+            serverWeb.setContentLength(CONTENT_LENGTH_UNKNOWN);
+            serverWeb.send(HTTP_CODE_OK, contTypeText, "");
+            logFileHistory([](const char *data, size_t len)
+                           { serverWeb.sendContent(data, len); });
+            serverWeb.sendContent("");
+        }
+        break;
+        case API_GET_LOG:
+        { // &since=<seq> returns only newer records, the cursor for the next call is in Log-Seq
+            const char *since = "since";
+            String result;
+            if (serverWeb.hasArg(since))
+            {
+                uint32_t last, lost;
+                result = logPrintSince(strtoul(serverWeb.arg(since).c_str(), nullptr, 10), last, lost);
+                serverWeb.sendHeader("Log-Seq", String(last));
+                if (lost)
+                    serverWeb.sendHeader("Log-Lost", String(lost));
+            }
+            else
+            {
+                result = logPrint();
+            }
             serverWeb.send(HTTP_CODE_OK, contTypeText, result);
         }
         break;
@@ -1165,6 +1571,57 @@ void handleSaveParams()
             {
                 doc[port] = 6638;
             }
+            const char *bridgeMode = "bridgeMode";
+            if (serverWeb.hasArg(bridgeMode))
+            {
+                doc[bridgeMode] = serverWeb.arg(bridgeMode).toInt();
+                ConfigSettings.bridgeMode = (uint8_t)doc[bridgeMode] == BRIDGE_MODE_LOOP ? BRIDGE_MODE_LOOP : BRIDGE_MODE_TASK; // applied live
+            }
+            const char *monitorPort = "monitorPort";
+            doc[monitorPort] = serverWeb.arg(monitorPort).toInt();
+            const char *capturePort = "capturePort";
+            doc[capturePort] = serverWeb.arg(capturePort).toInt();
+            const char *tlsPort = "tlsPort";
+            doc[tlsPort] = serverWeb.arg(tlsPort).toInt();
+            const char *flowCtrl = "flowCtrl";
+            doc[flowCtrl] = serverWeb.arg(flowCtrl) == on ? 1 : 0;
+            const char *rtsPin = "rtsPin";
+            const char *ctsPin = "ctsPin";
+            doc[rtsPin] = serverWeb.arg(rtsPin).length() ? serverWeb.arg(rtsPin).toInt() : -1;
+            doc[ctsPin] = serverWeb.arg(ctsPin).length() ? serverWeb.arg(ctsPin).toInt() : -1;
+            const char *coalesce = "coalesce";
+            const char *coalesceUs = "coalesceUs";
+            const char *coalesceBytes = "coalesceBytes";
+            if (serverWeb.hasArg(coalesce))
+            { // applied live
+                doc[coalesce] = min(serverWeb.arg(coalesce).toInt(), (long)BRIDGE_COALESCE_FRAME);
+                doc[coalesceUs] = constrain(serverWeb.arg(coalesceUs).toInt(), 0, 65000);
+                doc[coalesceBytes] = constrain(serverWeb.arg(coalesceBytes).toInt(), 1, BRIDGE_BUF_SIZE);
+                ConfigSettings.coalesceUs = doc[coalesceUs];
+                ConfigSettings.coalesceBytes = doc[coalesceBytes];
+                ConfigSettings.bridgeCoalesce = static_cast<BRIDGE_COALESCE_t>((uint8_t)doc[coalesce]);
+            }
+            const char *keepIdle = "keepIdle";
+            const char *keepIntvl = "keepIntvl";
+            const char *keepCount = "keepCount";
+            const char *writeDeadline = "writeDeadline";
+            if (serverWeb.hasArg(keepIdle))
+            { // applied live, keepalive to connections accepted from now on
+                doc[keepIdle] = constrain(serverWeb.arg(keepIdle).toInt(), 0, 7200);
+                doc[keepIntvl] = constrain(serverWeb.arg(keepIntvl).toInt(), 1, 255);
+                doc[keepCount] = constrain(serverWeb.arg(keepCount).toInt(), 1, 255);
+                doc[writeDeadline] = constrain(serverWeb.arg(writeDeadline).toInt(), 0, 60000);
+                ConfigSettings.keepIdle = doc[keepIdle];
+                ConfigSettings.keepIntvl = doc[keepIntvl];
+                ConfigSettings.keepCount = doc[keepCount];
+                ConfigSettings.writeDeadlineMs = doc[writeDeadline];
+            }
+            const char *holdDown = "holdDown";
+            if (serverWeb.hasArg(holdDown))
+            { // applied live
+                doc[holdDown] = constrain(serverWeb.arg(holdDown).toInt(), 0, 60000);
+                ConfigSettings.holdMs = doc[holdDown];
+            }
             configFile = LittleFS.open(configFileSerial, FILE_WRITE);
             serializeJson(doc, configFile);
             configFile.close();
@@ -1213,6 +1670,11 @@ void handleSaveParams()
             }
             const char *fwIp = "fwIp";
             doc[fwIp] = serverWeb.arg(fwIp);
+            bridgeLock(); // applied live, the bridge task matches against it on accept
+            ConfigSettings.fwEnabled = (uint8_t)doc[fwEnabled];
+            strlcpy(ConfigSettings.fwIp, doc[fwIp] | "", sizeof(ConfigSettings.fwIp));
+            bridgeAllowSet(ConfigSettings.fwIp);
+            bridgeUnlock();
             doc["webPass"] = serverWeb.arg("webPass");
 
             configFile = LittleFS.open(configFileSecurity, FILE_WRITE);
@@ -1242,6 +1704,20 @@ void handleSaveParams()
             {
                 doc[timeZoneName] = serverWeb.arg(timeZoneName);
             }
+            const char *logHost = "logHost";
+            const char *logPort = "logPort";
+            const char *logFormat = "logFormat";
+            if (serverWeb.hasArg(logHost))
+            { // applied live
+                strlcpy(ConfigSettings.logHost, serverWeb.arg(logHost).c_str(), sizeof(ConfigSettings.logHost));
+                const long port = serverWeb.arg(logPort).toInt();
+                ConfigSettings.logPort = port > 0 && port <= 65535 ? port : 514;
+                ConfigSettings.logFormat = constrain(serverWeb.arg(logFormat).toInt(), 0, LOG_EXPORT_LINE);
+                doc[logHost] = ConfigSettings.logHost;
+                doc[logPort] = ConfigSettings.logPort;
+                doc[logFormat] = ConfigSettings.logFormat;
+                logExportSet(ConfigSettings.logHost, ConfigSettings.logPort, (LOG_EXPORT_FORMAT_t)ConfigSettings.logFormat);
+            }
             configFile = LittleFS.open(configFileGeneral, FILE_WRITE);
             configFile = LittleFS.open(configFileGeneral, FILE_WRITE);
             serializeJson(doc, configFile);
@@ -1335,7 +1811,7 @@ void handleSecurity()
     {
         doc["fwEnabled"] = checked;
     }
-    doc["fwIp"] = ConfigSettings.fwIp.toString();
+    doc["fwIp"] = ConfigSettings.fwIp;
 
     serializeJson(doc, result);
     serverWeb.sendHeader(respHeaderName, result);
@@ -1386,11 +1862,74 @@ void handleSerial()
     {
         doc["115200"] = checked;
     }
+    else if (ConfigSettings.serialSpeed == 230400)
+    {
+        doc["230400"] = checked;
+    }
+    else if (ConfigSettings.serialSpeed == 460800)
+    {
+        doc["460800"] = checked;
+    }
+    else if (ConfigSettings.serialSpeed == 921600)
+    {
+        doc["921600"] = checked;
+    }
     else
     {
         doc["115200"] = checked;
     }
     doc["socketPort"] = String(ConfigSettings.socketPort);
+    if (ConfigSettings.monitorPort > 0)
+    {
+        doc["monitorPort"] = String(ConfigSettings.monitorPort);
+    }
+    if (ConfigSettings.capturePort > 0)
+    {
+        doc["capturePort"] = String(ConfigSettings.capturePort);
+    }
+    if (ConfigSettings.tlsPort > 0)
+    {
+        doc["tlsPort"] = String(ConfigSettings.tlsPort);
+    }
+    if (ConfigSettings.serialFlowCtrl)
+    {
+        doc["flowCtrl"] = checked;
+    }
+    if (ConfigSettings.rtsPin >= 0)
+    {
+        doc["rtsPin"] = String(ConfigSettings.rtsPin);
+    }
+    if (ConfigSettings.ctsPin >= 0)
+    {
+        doc["ctsPin"] = String(ConfigSettings.ctsPin);
+    }
+    if (ConfigSettings.bridgeMode == BRIDGE_MODE_LOOP)
+    {
+        doc["bridgeModeLoop"] = checked;
+    }
+    else
+    {
+        doc["bridgeModeTask"] = checked;
+    }
+    if (ConfigSettings.bridgeCoalesce == BRIDGE_COALESCE_BATCH)
+    {
+        doc["coalesceBatch"] = checked;
+    }
+    else if (ConfigSettings.bridgeCoalesce == BRIDGE_COALESCE_FRAME)
+    {
+        doc["coalesceFrame"] = checked;
+    }
+    else
+    {
+        doc["coalesceImmediate"] = checked;
+    }
+    doc["coalesceUs"] = String(ConfigSettings.coalesceUs);
+    doc["coalesceBytes"] = String(ConfigSettings.coalesceBytes);
+    doc["keepIdle"] = String(ConfigSettings.keepIdle);
+    doc["keepIntvl"] = String(ConfigSettings.keepIntvl);
+    doc["keepCount"] = String(ConfigSettings.keepCount);
+    doc["writeDeadline"] = String(ConfigSettings.writeDeadlineMs);
+    doc["holdDown"] = String(ConfigSettings.holdMs);
 
     serializeJson(doc, result);
     serverWeb.sendHeader(respHeaderName, result);
@@ -1742,6 +2281,9 @@ void handleSysTools()
 
     doc["hostname"] = ConfigSettings.hostname;
     doc["refreshLogs"] = ConfigSettings.refreshLogs;
+    doc["logHost"] = ConfigSettings.logHost;
+    doc["logPort"] = ConfigSettings.logPort;
+    doc["logFormat"] = ConfigSettings.logFormat;
     if (ConfigSettings.timeZone)
     {
         doc["timeZoneName"] = ConfigSettings.timeZone;
@@ -1818,30 +2360,9 @@ void handleZigbeeRestart()
     }
 }
 
-void printLogTime()
-{
-    String tmpTime;
-    unsigned long timeLog = millis();
-    tmpTime = String(timeLog, DEC);
-    logPush('[');
-    for (int j = 0; j < tmpTime.length(); j++)
-    {
-        logPush(tmpTime[j]);
-    }
-    logPush(']');
-}
-
 void printLogMsg(String msg)
-{
-    printLogTime();
-    logPush(' ');
-    logPush('|');
-    logPush(' ');
-    for (int j = 0; j < msg.length(); j++)
-    {
-        logPush(msg[j]);
-    }
-    logPush('\n');
+{ // one record per message, time stamp and separator are added when the log is read
+    logWrite(LOG_LEVEL_INFO, LOG_SOURCE_SYSTEM, msg.c_str(), msg.length());
 }
 
 void progressFunc(unsigned int progress, unsigned int total)
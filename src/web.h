@@ -1,5 +1,6 @@
 #include <Arduino.h>
 void handleEvents();
+void logStreamService();
 void initWebServer();
 void webServerHandleClient();
 void handleGeneral();
@@ -17,7 +18,6 @@ void handleApi();
 void handleStatus();
 void sendGzip(const char* contentType, const uint8_t content[], uint16_t contentLen);
 void handleSysTools();
-void printLogTime();
 void printLogMsg(String msg);
 void handleSaveParams();
 bool checkAuth();
@@ -45,7 +45,14 @@ const api = {
 		API_WIFICONNECTSTAT: 7,
 		API_CMD: 8,
 		API_GET_LOG: 9,
-		API_FLASH_ZB: 10
+		API_FLASH_ZB: 10,
+		API_GET_BRIDGE: 11,
+		API_PROBE_BAUD: 12,
+		API_GET_METRICS: 13,
+		API_GET_RECORDER: 14,
+		API_PING_BENCH: 15,
+		API_GET_LOG_HISTORY: 16,
+		API_PING_RESULT: 17
 	},
 	pages: pages
 }
@@ -162,6 +169,47 @@ advanced:
 	$("#generatedFile").val(result);
 }
 
+function probeBaud() {
+	$("#probeBaud").prop("disabled", true);
+	$.get(apiLink + api.actions.API_PROBE_BAUD + "&save=1", function (data) {
+		if (data.baud) {
+			$("#baud").val(data.baud);
+			alert("Coordinator answers at " + data.baud + " baud, saved.");
+		} else {
+			alert("Coordinator did not answer SYS_PING at any speed.");
+		}
+	}).fail(function (xhr) {
+		alert(xhr.responseText);
+	}).always(function () {
+		$("#probeBaud").prop("disabled", false);
+	});
+}
+
+function pingBench() {
+	$("#pingBench").prop("disabled", true);
+	const done = () => $("#pingBench").prop("disabled", false);
+	const poll = () => {
+		$.get(apiLink + api.actions.API_PING_RESULT, function (data, status, xhr) {
+			if (xhr.status == 202) {
+				setTimeout(poll, 500);
+				return;
+			}
+			alert("SYS_PING x" + data.count + ": min " + data.minUs + " us, p50 " + data.p50Us + " us, p99 " + data.p99Us +
+				" us, max " + data.maxUs + " us, loss " + data.loss.toFixed(1) + "%" + (data.complete ? "" : " (stopped, bridge not serviced)"));
+			done();
+		}).fail(function (xhr) {
+			alert(xhr.responseText);
+			done();
+		});
+	};
+	$.get(apiLink + api.actions.API_PING_BENCH + "&count=100", function () {
+		setTimeout(poll, 500);
+	}).fail(function (xhr) {
+		alert(xhr.responseText);
+		done();
+	});
+}
+
 function fillFileTable(files) {
 	const icon = "<i class='bi bi-filetype-json'></i>";
 	files.forEach((elem) => {
@@ -1251,11 +1299,66 @@ function readfile(file) {
 	});
 }
 
+function consoleAppend(text) {
+	text = $("#console").val() + text;
+	if (text.length > 65536) {
+		text = text.substring(text.indexOf("\n", text.length - 65536) + 1);
+	}
+	$("#console").val(text);
+}
+
 function logRefresh(ms) {
+	if (!window.EventSource) {
+		logPoll(ms);
+		return;
+	}
+	var opened = false;
+	var source = new EventSource('/events?log=1');
+	const gone = () => {
+		if (!$("#console").length) {//page left
+			source.close();
+			return true;
+		}
+		return false;
+	};
+	source.addEventListener('open', function (e) {
+		opened = true;
+	}, false);
+	source.addEventListener('error', function (e) {
+		if (!opened) {//no stream on this firmware or all slots taken
+			source.close();
+			logPoll(ms);
+		}
+	}, false);
+	source.addEventListener('log', function (e) {
+		if (!gone()) consoleAppend(e.data + "\n");
+	}, false);
+	source.addEventListener('lost', function (e) {
+		if (!gone()) consoleAppend("... " + e.data + " lines overwritten\n");
+	}, false);
+	source.addEventListener('reset', function (e) {
+		if (!gone()) $("#console").val("");
+	}, false);
+	source.addEventListener('bridge', function (e) {
+		if (gone()) return;
+		const b = JSON.parse(e.data);
+		$("#bridgeLive").text("Bridge: " + b.clients + " clients, Zigbee -> net " + b.zbToNet.frames + " frames / " + b.zbToNet.bytes + " B, net -> Zigbee " + b.netToZb.frames + " frames / " + b.netToZb.bytes + " B, " + b.writeStalls + " stalls");
+	}, false);
+}
+
+function logPoll(ms) {
+	var logSeq = 0;
 	var logUpd = setInterval(() => {
-		$.get(apiLink + api.actions.API_GET_LOG, function (data) {
+		$.get(apiLink + api.actions.API_GET_LOG + "&since=" + logSeq, function (data, status, xhr) {
 			if ($("#console").length) {//elem exists
-				$("#console").val(data);
+				const seq = parseInt(xhr.getResponseHeader("Log-Seq"));
+				const lost = xhr.getResponseHeader("Log-Lost");
+				if (seq < logSeq) {//gateway restarted
+					$("#console").val(data);
+				} else if (data.length || lost) {
+					consoleAppend((lost ? "... " + lost + " lines overwritten\n" : "") + data);
+				}
+				if (!isNaN(seq)) logSeq = seq;
 			} else {
 				clearInterval(logUpd);
 			}
@@ -15,6 +15,8 @@
 #include "log.h"
 #include "etc.h"
 #include "zb.h"
+#include "bridge.h"
+#include "mt.h"
 
 extern struct ConfigSettingsStruct ConfigSettings;
 extern struct zbVerStruct zbVer;
@@ -32,6 +34,8 @@ const byte cmdLedLen = 0x02;
 const byte zigLed1Off[] = {cmdFrameStart, cmdLedLen, cmdLed0, cmdLed1, cmdLedIndex, cmdLedStateOff, 0x2E}; // resp FE 01 67 0A 00 6C
 const byte zigLed1On[] = {cmdFrameStart, cmdLedLen, cmdLed0, cmdLed1, cmdLedIndex, cmdLedStateOn, 0x2F};
 const byte cmdLedResp[] = {0xFE, 0x01, 0x67, 0x0A, 0x00, 0x6C};
+const byte cmdSysPing[] = {cmdFrameStart, 0x00, 0x21, 0x01, 0x20}; // resp FE 02 61 01 <capabilities> FCS
+const uint32_t zbProbeBauds[] = {921600, 460800, 230400, 115200}; // fastest first
 
 size_t lastSize = 0;
 
@@ -45,8 +49,19 @@ void clearS2Buffer()
     }
 }
 
+bool waitS2Buffer(int len, uint16_t timeout)
+{ // until len bytes are buffered or timeout ms have passed
+    const uint32_t start = millis();
+    while (Serial2.available() < len && millis() - start < timeout)
+    {
+        delay(1);
+    }
+    return Serial2.available() >= len;
+}
+
 void getZbVer()
 {
+    bridgeLock(); // keep the socket bridge off Serial2 meanwhile
     zbVer.zbRev = 0;
     const byte cmdFrameStart = 0xFE;
     const byte zero = 0x00;
@@ -81,10 +96,11 @@ void getZbVer()
             break;
         }
     }
+    bridgeUnlock();
 }
 
 void zbCheck()
-{
+{ // bridgeLock() is held per LED command exchange only, the socket bridge runs between retries
     // getZbChip();
     //  Serial2.begin(115200, SERIAL_8N1, CC2652P_RXD, CC2652P_TXD); //start zigbee serial
     bool respOk = false;
@@ -92,10 +108,12 @@ void zbCheck()
     { // wait for zigbee start
         if (respOk)
             break;
+        bridgeLock();
         clearS2Buffer();
         Serial2.write(zigLed1On, sizeof(zigLed1On));
         Serial2.flush();
-        delay(400);
+        const uint32_t sent = millis();
+        waitS2Buffer(sizeof(cmdLedResp), 400);
         for (uint8_t i = 0; i < 5; i++)
         {
             if (Serial2.read() != 0xFE)
@@ -118,7 +136,11 @@ void zbCheck()
                 }
             }
         }
+        bridgeUnlock();
         digitalWrite(LED_USB, !digitalRead(LED_USB)); // blue led flashing mean wait for zigbee resp
+        const uint32_t spent = millis() - sent;
+        if (!respOk && spent < 400)
+            delay(400 - spent); // keep the retry pace without the lock
     }
     delay(500);
     if (!respOk)
@@ -137,10 +159,12 @@ void zbCheck()
     }
     else
     {
+        bridgeLock();
         Serial2.write(zigLed1Off, sizeof(zigLed1Off));
         Serial2.flush();
-        delay(250);
+        waitS2Buffer(sizeof(cmdLedResp), 250);
         clearS2Buffer();
+        bridgeUnlock();
         printLogMsg("[ZBCHK] Connection OK");
     }
     digitalWrite(LED_PWR, 0);
@@ -149,6 +173,7 @@ void zbCheck()
 
 void zbLedToggle()
 {
+    bridgeLock();
     bool respOk = false;
     clearS2Buffer();
     if (ConfigSettings.zbLedState == 0)
@@ -190,6 +215,7 @@ void zbLedToggle()
         printLogMsg("[ZB] LED toggle OK");
         ConfigSettings.zbLedState = !ConfigSettings.zbLedState;
     }
+    bridgeUnlock();
 }
 
 void preParse()
@@ -254,6 +280,7 @@ void runFlash()
 
 void checkFwHex(const char *tempFile) // check Zigbee FW file using IntelHEX, than check BSL pin.
 {
+    bridgeLock();
     IntelHex zb_hex(tempFile);
 
     // zb_hex.validateChecksum();
@@ -317,6 +344,7 @@ void checkFwHex(const char *tempFile) // check Zigbee FW file using IntelHEX, th
         printLogMsg(msg);
         runFlash();
     }
+    bridgeUnlock();
 }
 
 void zbInit()
@@ -344,4 +372,62 @@ void zbInit()
         printLogMsg(String("[ZBCHIP] ") + msg);
         DEBUG_PRINTLN(msg);
     }
-}
\ No newline at end of file
+}
+
+void zbSerialSetup()
+{ // apply the loaded serial config to Serial2
+    bridgeLock();
+    Serial2.updateBaudRate(ConfigSettings.serialSpeed);
+    if (ConfigSettings.serialFlowCtrl && ConfigSettings.rtsPin >= 0 && ConfigSettings.ctsPin >= 0)
+    {
+        Serial2.setPins(CC2652P_RXD, CC2652P_TXD, ConfigSettings.ctsPin, ConfigSettings.rtsPin);
+        Serial2.setHwFlowCtrlMode(UART_HW_FLOWCTRL_CTS_RTS, ZB_UART_RTS_THRESHOLD);
+        printLogMsg(String("[ZB] RTS/CTS flow control on, RTS ") + ConfigSettings.rtsPin + " CTS " + ConfigSettings.ctsPin);
+    }
+    bridgeUnlock();
+}
+
+bool zbPing(uint16_t timeout)
+{ // SYS_PING round trip, caller holds bridgeLock()
+    MtParserStruct parser = {};
+    clearS2Buffer();
+    Serial2.write(cmdSysPing, sizeof(cmdSysPing));
+    Serial2.flush();
+    const uint32_t start = millis();
+    while (millis() - start < timeout)
+    {
+        while (Serial2.available())
+        {
+            const uint16_t len = mtParserFeed(parser, Serial2.read());
+            if (len && parser.frame[2] == 0x61 && parser.frame[3] == cmdSysPing[3])
+            {
+                return true;
+            }
+        }
+        delay(1);
+    }
+    return false;
+}
+
+uint32_t zbProbeBaud()
+{ // fastest rate the coordinator firmware answers SYS_PING on, 0 if none
+    uint32_t found = 0;
+    bridgeLock();
+    for (uint8_t i = 0; i < sizeof(zbProbeBauds) / sizeof(zbProbeBauds[0]) && !found; i++)
+    {
+        Serial2.updateBaudRate(zbProbeBauds[i]);
+        delay(20);
+        for (uint8_t attempt = 0; attempt < 3 && !found; attempt++)
+        {
+            if (zbPing(200))
+            {
+                found = zbProbeBauds[i];
+            }
+        }
+        printLogMsg(String("[ZB] Baud probe ") + zbProbeBauds[i] + (found ? " OK" : " no answer"));
+    }
+    Serial2.updateBaudRate(found ? found : ConfigSettings.serialSpeed);
+    clearS2Buffer();
+    bridgeUnlock();
+    return found;
+}
@@ -6,3 +6,6 @@ void checkFwHex(const char *tempFile);
 void runFlash();
 bool programFlashFromFile(const char *filePath);
 void zbInit();
+void zbSerialSetup();
+bool zbPing(uint16_t timeout);
+uint32_t zbProbeBaud();
@@ -0,0 +1,121 @@
+#!/usr/bin/env python3
+# Round-trip benchmark of the Zigbee socket bridge, idle and under HTTP load.
+#
+# Sends ZNP SYS_PING requests through the TCP bridge and times the SRSP. The
+# same run is then repeated while worker threads keep the web UI busy, so the
+# two sets of figures show whether HTTP serving slows the bridge down.
+#
+#   python3 tools/bridge_bench.py 192.168.1.10
+#   python3 tools/bridge_bench.py 192.168.1.10 --port 6638 --count 1000 --http-threads 4
+#
+# Stop zigbee2mqtt / ZHA first: the coordinator answers every client, and
+# the host stack would see the extra SYS_PING responses.
+
+import argparse
+import socket
+import statistics
+import threading
+import time
+import urllib.request
+
+MT_SOF = 0xFE
+SYS_PING = bytes([MT_SOF, 0x00, 0x21, 0x01, 0x20])  # SREQ SYS 0x01, FCS 0x20
+
+
+def read_frame(sock, buf):
+    """Return (cmd0, cmd1, payload) of the next MT frame, buf keeps leftovers."""
+    while True:
+        start = buf.find(bytes([MT_SOF]))
+        if start < 0:
+            buf.clear()  # no frame start in there, nothing worth keeping
+        elif start > 0:
+            del buf[:start]
+        if len(buf) >= 5 and buf[0] == MT_SOF:
+            frame_len = 5 + buf[1]
+            if len(buf) >= frame_len:
+                frame = bytes(buf[:frame_len])
+                del buf[:frame_len]
+                return frame[2], frame[3], frame[4:-1]
+        data = sock.recv(4096)
+        if not data:
+            raise ConnectionError("bridge closed the connection")
+        buf.extend(data)
+
+
+def ping_rtts(host, port, count, timeout):
+    rtts = []
+    lost = 0
+    buf = bytearray()
+    with socket.create_connection((host, port), timeout=timeout) as sock:
+        sock.setsockopt(socket.IPPROTO_TCP, socket.TCP_NODELAY, 1)
+        for _ in range(count):
+            start = time.perf_counter()
+            sock.sendall(SYS_PING)
+            try:
+                while True:
+                    cmd0, cmd1, _ = read_frame(sock, buf)
+                    if cmd0 == 0x61 and cmd1 == 0x01:  # SRSP SYS_PING
+                        break
+                rtts.append((time.perf_counter() - start) * 1000.0)
+            except socket.timeout:
+                lost += 1
+                buf.clear()
+    return rtts, lost
+
+
+def http_load(url, stop, counter):
+    while not stop.is_set():
+        try:
+            with urllib.request.urlopen(url, timeout=5) as resp:
+                resp.read()
+            counter[0] += 1
+        except OSError:
+            counter[1] += 1
+
+
+def report(name, rtts, lost, extra=""):
+    if not rtts:
+        print(f"{name:>10}: no answers, {lost} lost")
+        return
+    rtts.sort()
+    p50 = rtts[len(rtts) // 2]
+    p99 = rtts[min(len(rtts) - 1, int(len(rtts) * 0.99))]
+    print(f"{name:>10}: n={len(rtts)} lost={lost} min={rtts[0]:.2f} p50={p50:.2f} "
+          f"p99={p99:.2f} max={rtts[-1]:.2f} mean={statistics.mean(rtts):.2f} ms{extra}")
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Bridge SYS_PING round trip, idle vs. HTTP load")
+    parser.add_argument("host")
+    parser.add_argument("--port", type=int, default=6638, help="bridge TCP port")
+    parser.add_argument("--count", type=int, default=500, help="pings per run")
+    parser.add_argument("--timeout", type=float, default=1.0, help="seconds before a ping counts as lost")
+    parser.add_argument("--http-threads", type=int, default=4, help="concurrent HTTP clients in the loaded run")
+    parser.add_argument("--http-path", default="/", help="page fetched by the HTTP load (static, no bridge lock)")
+    args = parser.parse_args()
+
+    rtts, lost = ping_rtts(args.host, args.port, args.count, args.timeout)
+    report("idle", rtts, lost)
+
+    stop = threading.Event()
+    counter = [0, 0]  # requests ok, failed
+    url = f"http://{args.host}{args.http_path}"
+    workers = [threading.Thread(target=http_load, args=(url, stop, counter), daemon=True)
+               for _ in range(args.http_threads)]
+    for worker in workers:
+        worker.start()
+    started = time.perf_counter()
+    rtts, lost = ping_rtts(args.host, args.port, args.count, args.timeout)
+    elapsed = time.perf_counter() - started
+    stop.set()
+    for worker in workers:
+        worker.join()
+    report("http load", rtts, lost,
+           f", http {counter[0] / elapsed:.1f} req/s, {counter[1]} failed")
+    if not counter[0]:
+        print("no HTTP request was answered while the socket client was connected, "
+              "the loaded run measured an idle bridge")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,658 @@
+// Host build of the bridge core (src/bridge_core.cpp) with a fake CC2652 behind a pseudo terminal.
+//
+// The coordinator side writes ZNP AF_INCOMING_MSG frames into the pty master, the bridge reads the
+// slave end exactly like Serial2 and serves real TCP sockets on 127.0.0.1. A client reads the frames
+// back and checks them. Every bridge mode (loop, task) is run with every coalescing policy:
+//
+//   throughput: --frames frames written as fast as the pty takes them (or at --baud), MB/s and frames/s
+//   latency:    --latency-frames frames one every --gap-us, p50/p99 from pty write to TCP read
+//   ping:       --pings SYS_PING round trips of the built-in benchmark, run during the latency phase;
+//               the client must not see a single SYS_PING response; --late-every N answers every Nth
+//               ping after its timeout, inside the grace time, those count as lost and must not leak either
+//   hold-down:  frames sent while no client is connected must reach the next client once, in order,
+//               starting on a frame boundary, unless they are older than the TTL
+//   hex dump:   --hex-bytes bytes formatted into traffic log lines, the former sprintf(" %02x") per
+//               byte against hexFormat(), ns per forwarded byte; both must produce the same text
+//
+//   tools/bridge_host/build.sh && ./_host/bridge_bench --frames 50000
+//
+// --capture file.pcapng also streams the capture port output of the last run into a file.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <termios.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "bridge_core.h"
+#include "mt.h"
+#include "hex.h"
+
+enum HOST_MODE_t : uint8_t
+{
+  HOST_MODE_LOOP, // polled with a fixed sleep, like loop() sharing the core with web and mqtt
+  HOST_MODE_TASK  // blocks in poll() on the pty and sockets, like bridgeTask + bridgeWatchTask
+};
+
+struct BenchOptions
+{
+  uint32_t frames = 20000;
+  uint32_t latencyFrames = 2000;
+  uint32_t gapUs = 2000;
+  uint32_t baud = 0; // 0 = unpaced
+  uint32_t loopUs = 1000;
+  uint16_t coalesceUs = 2000;
+  uint16_t coalesceBytes = 256;
+  uint16_t pings = 200;
+  uint32_t lateEvery = 0; // 0 = every SYS_PING answered right away
+  uint32_t hexBytes = 1 << 20;
+};
+
+struct BenchResult
+{
+  double mbps;
+  double fps;
+  double p50Us;
+  double p99Us;
+  uint32_t lost;
+  uint32_t badFcs;
+  uint32_t foreign; // frames the client did not expect, leaked benchmark answers
+  BridgePingResultStruct ping;
+};
+
+int uartFd = -1;
+int captureSink = -1; // our end of the capture socket pair
+const char *capturePath = NULL;
+int64_t timerDeadline = -1; // bridgeMicros() value, -1 = not armed
+std::atomic<bool> stopBridge(false);
+std::atomic<bool> stopResponder(false);
+std::mutex masterWrite; // whole frames only, the stream and the SYS_PING answers share the pty
+
+int64_t nowNs()
+{
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+uint32_t bridgeMillis()
+{
+  return nowNs() / 1000000;
+}
+
+uint32_t bridgeMicros()
+{
+  return nowNs() / 1000;
+}
+
+uint64_t bridgeTimeUs()
+{
+  return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+int bridgeUartAvailable()
+{
+  int avail = 0;
+  if (ioctl(uartFd, FIONREAD, &avail) < 0)
+    return 0;
+  return avail;
+}
+
+size_t bridgeUartRead(uint8_t *buf, size_t len)
+{
+  const ssize_t got = read(uartFd, buf, len);
+  return got > 0 ? got : 0;
+}
+
+void bridgeUartWrite(const uint8_t *buf, size_t len)
+{
+  while (len > 0)
+  {
+    const ssize_t put = write(uartFd, buf, len);
+    if (put <= 0)
+      return;
+    buf += put;
+    len -= put;
+  }
+}
+
+void bridgeTimerArm(uint32_t us)
+{
+  timerDeadline = (int64_t)bridgeMicros() + us;
+}
+
+void bridgeBufLog(BridgeBuf *)
+{ // no web console on the host
+}
+
+void bridgeAllowRejected(const char *entry)
+{
+  fprintf(stderr, "allow-list entry ignored: %s\n", entry);
+}
+
+void bridgeClientLost(uint8_t cln, bool evicted)
+{
+  if (evicted)
+    fprintf(stderr, "client %u evicted, tx queue overflow\n", cln);
+  close(clientFd[cln]);
+  bridgeCoreClientReset(cln);
+}
+
+int bridgeClientRecv(uint8_t cln, uint8_t *buf, size_t len)
+{
+  return recv(clientFd[cln], buf, len, MSG_DONTWAIT);
+}
+
+int bridgeClientSend(uint8_t cln, const uint8_t *buf, size_t len)
+{
+  return send(clientFd[cln], buf, len, MSG_DONTWAIT);
+}
+
+void hostAccept(int listenFd)
+{
+  const int fd = accept(listenFd, NULL, NULL);
+  if (fd < 0)
+    return;
+  for (uint8_t cln = 0; cln < MAX_SOCKET_CLIENTS; cln++)
+  {
+    if (clientFd[cln] < 0)
+    {
+      const int one = 1;
+      setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+      fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+      bool primary = true;
+      for (uint8_t i = 0; i < MAX_SOCKET_CLIENTS; i++)
+        primary = primary && !(clientFd[i] >= 0 && clientRole[i] == CLIENT_ROLE_PRIMARY);
+      bridgeCoreClientOpen(cln, fd, primary ? CLIENT_ROLE_PRIMARY : CLIENT_ROLE_MONITOR);
+      return;
+    }
+  }
+  close(fd); // no free slot
+}
+
+void hostBridge(HOST_MODE_t mode, int listenFd, const BenchOptions &opt)
+{ // plays bridgeService() / bridgeTask()
+  while (!stopBridge)
+  {
+    if (mode == HOST_MODE_LOOP)
+    {
+      std::this_thread::sleep_for(std::chrono::microseconds(opt.loopUs));
+    }
+    else
+    {
+      pollfd fds[2 + MAX_SOCKET_CLIENTS];
+      nfds_t count = 0;
+      fds[count++] = {listenFd, POLLIN, 0};
+      fds[count++] = {uartFd, POLLIN, 0};
+      for (uint8_t cln = 0; cln < MAX_SOCKET_CLIENTS; cln++)
+      {
+        if (clientFd[cln] >= 0)
+          fds[count++] = {clientFd[cln], (short)(POLLIN | (clientTxWait[cln] ? POLLOUT : 0)), 0};
+      }
+      int timeoutMs = 10;
+      if (timerDeadline >= 0)
+        timeoutMs = std::max<int64_t>(0, (timerDeadline - (int64_t)bridgeMicros() + 999) / 1000);
+      poll(fds, count, timeoutMs);
+    }
+    if (timerDeadline >= 0 && (int64_t)bridgeMicros() >= timerDeadline)
+      timerDeadline = -1;
+    hostAccept(listenFd);
+    bridgeCoreService();
+    if (captureSink >= 0 && !bridgeCaptureDrain())
+      bridgeCaptureStop();
+  }
+  for (uint8_t i = 0; captureSink >= 0 && i < 50; i++)
+  { // leave nothing behind in the capture ring
+    bridgeCaptureDrain();
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+}
+
+void captureWriter(int sock, FILE *file)
+{ // plays the capture port client
+  uint8_t buf[4096];
+  ssize_t n;
+  while ((n = recv(sock, buf, sizeof(buf), 0)) > 0)
+    fwrite(buf, 1, n, file);
+}
+
+size_t makeFrame(uint8_t *frame, uint32_t seq, uint8_t payloadLen)
+{ // AF_INCOMING_MSG carrying seq and the write time, padded to payloadLen
+  frame[0] = MT_SOF;
+  frame[1] = payloadLen;
+  frame[2] = 0x44;
+  frame[3] = 0x81;
+  memset(frame + MT_HEADER_LEN, 0xa5, payloadLen);
+  memcpy(frame + MT_HEADER_LEN, &seq, sizeof(seq));
+  const int64_t stamp = nowNs();
+  memcpy(frame + MT_HEADER_LEN + sizeof(seq), &stamp, sizeof(stamp));
+  frame[MT_HEADER_LEN + payloadLen] = mtFcs(frame + 1, MT_HEADER_LEN - 1 + payloadLen);
+  return MT_HEADER_LEN + payloadLen + 1;
+}
+
+bool masterPut(int master, const uint8_t *p, size_t left)
+{
+  std::lock_guard<std::mutex> lock(masterWrite);
+  while (left > 0)
+  {
+    const ssize_t put = write(master, p, left);
+    if (put < 0)
+    {
+      if (errno == EAGAIN || errno == EINTR)
+        continue;
+      return false;
+    }
+    p += put;
+    left -= put;
+  }
+  return true;
+}
+
+void fakeCoordinator(int master, uint32_t frames, uint32_t gapUs, uint32_t baud)
+{ // plays the CC2652: frames of 12..100 payload bytes, paced by gapUs or the baud rate
+  uint8_t frame[MT_FRAME_MAX];
+  const int64_t start = nowNs();
+  uint64_t sentBytes = 0;
+  for (uint32_t seq = 0; seq < frames; seq++)
+  {
+    if (gapUs)
+    {
+      const int64_t due = start + (int64_t)seq * gapUs * 1000;
+      while (nowNs() < due)
+        std::this_thread::sleep_for(std::chrono::microseconds(50));
+    }
+    else if (baud)
+    {
+      const int64_t due = start + (int64_t)(sentBytes * 10 * 1000000000ULL / baud);
+      while (nowNs() < due)
+        std::this_thread::sleep_for(std::chrono::microseconds(50));
+    }
+    const size_t len = makeFrame(frame, seq, 12 + (seq * 37) % 89);
+    if (!masterPut(master, frame, len))
+      return;
+    sentBytes += len;
+  }
+}
+
+void pingResponder(int master, uint32_t lateEvery)
+{ // plays the CC2652 answering SYS_PING with its capabilities
+  const uint16_t pingTimeoutMs = 100; // as passed to bridgePingStart()
+  MtParserStruct parser = {};
+  uint8_t buf[256];
+  uint32_t pings = 0;
+  while (!stopResponder)
+  {
+    pollfd pfd = {master, POLLIN, 0};
+    if (poll(&pfd, 1, 10) <= 0)
+      continue;
+    const ssize_t n = read(master, buf, sizeof(buf));
+    for (ssize_t i = 0; i < n; i++)
+    {
+      if (mtParserFeed(parser, buf[i]) == 0 || parser.frame[2] != 0x21 || parser.frame[3] != 0x01)
+        continue;
+      uint8_t srsp[] = {MT_SOF, 0x02, 0x61, 0x01, 0x59, 0x07, 0};
+      srsp[6] = mtFcs(srsp + 1, 5);
+      if (lateEvery && ++pings % lateEvery == 0)
+        std::this_thread::sleep_for(std::chrono::milliseconds(pingTimeoutMs + BRIDGE_PING_GRACE_MS / 2));
+      masterPut(master, srsp, sizeof(srsp));
+    }
+  }
+}
+
+bool readClient(int sock, uint32_t frames, std::vector<double> &latencyUs, uint64_t &bytes, BenchResult &res, int64_t &lastNs)
+{ // parse frames back out of the TCP stream until all arrived or 2 s of silence
+  MtParserStruct parser = {};
+  uint8_t buf[4096];
+  uint32_t got = 0;
+  while (got < frames)
+  {
+    pollfd pfd = {sock, POLLIN, 0};
+    if (poll(&pfd, 1, 2000) <= 0)
+      return false;
+    const ssize_t n = recv(sock, buf, sizeof(buf), 0);
+    if (n <= 0)
+      return false;
+    const int64_t now = nowNs();
+    bytes += n;
+    for (ssize_t i = 0; i < n; i++)
+    {
+      if (mtParserFeed(parser, buf[i]) == 0)
+        continue;
+      if (parser.frame[2] != 0x44)
+      {
+        res.foreign++;
+        continue;
+      }
+      int64_t stamp;
+      memcpy(&stamp, parser.frame + MT_HEADER_LEN + sizeof(uint32_t), sizeof(stamp));
+      latencyUs.push_back((now - stamp) / 1000.0);
+      lastNs = now;
+      got++;
+    }
+    res.badFcs = parser.badFcs;
+  }
+  return true;
+}
+
+double percentile(std::vector<double> &v, double q)
+{
+  if (v.empty())
+    return 0;
+  std::sort(v.begin(), v.end());
+  return v[std::min(v.size() - 1, (size_t)(v.size() * q))];
+}
+
+int openPty()
+{ // master for the fake coordinator, the raw slave end becomes the bridge's UART
+  const int master = posix_openpt(O_RDWR | O_NOCTTY);
+  if (master < 0 || grantpt(master) < 0 || unlockpt(master) < 0)
+    return -1;
+  termios tio;
+  tcgetattr(master, &tio);
+  cfmakeraw(&tio);
+  tcsetattr(master, TCSANOW, &tio);
+  uartFd = open(ptsname(master), O_RDWR | O_NOCTTY | O_NONBLOCK);
+  if (uartFd < 0)
+    return -1;
+  tcgetattr(uartFd, &tio);
+  cfmakeraw(&tio);
+  tcsetattr(uartFd, TCSANOW, &tio);
+  return master;
+}
+
+int openListen(sockaddr_in &addr)
+{ // bridge port on an ephemeral loopback port
+  const int listenFd = socket(AF_INET, SOCK_STREAM, 0);
+  addr = {};
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  socklen_t addrLen = sizeof(addr);
+  bind(listenFd, (sockaddr *)&addr, sizeof(addr));
+  listen(listenFd, MAX_SOCKET_CLIENTS);
+  fcntl(listenFd, F_SETFL, fcntl(listenFd, F_GETFL) | O_NONBLOCK);
+  getsockname(listenFd, (sockaddr *)&addr, &addrLen);
+  return listenFd;
+}
+
+bool runPhase(HOST_MODE_t mode, BRIDGE_COALESCE_t coalesce, const BenchOptions &opt, uint32_t frames, uint32_t gapUs, BenchResult &res, bool latency)
+{
+  const int master = openPty();
+  if (master < 0)
+    return false;
+  sockaddr_in addr;
+  const int listenFd = openListen(addr);
+
+  bridgeCoreInit();
+  BridgeCoreSettings.coalesce = coalesce;
+  BridgeCoreSettings.coalesceUs = opt.coalesceUs;
+  BridgeCoreSettings.coalesceBytes = opt.coalesceBytes;
+  timerDeadline = -1;
+  stopBridge = false;
+  stopResponder = false;
+  std::thread responder(pingResponder, master, opt.lateEvery);
+  if (latency && opt.pings)
+    bridgePingStart(opt.pings, 100); // starts with the bridge thread
+  int capturePair[2] = {-1, -1};
+  FILE *captureFile = NULL;
+  std::thread capture;
+  if (capturePath && (captureFile = fopen(capturePath, "wb")) && socketpair(AF_UNIX, SOCK_STREAM, 0, capturePair) == 0)
+  { // every run overwrites the file, the last one is kept
+    fcntl(capturePair[0], F_SETFL, fcntl(capturePair[0], F_GETFL) | O_NONBLOCK);
+    bridgeCaptureStart(capturePair[0]);
+    captureSink = capturePair[1];
+    capture = std::thread(captureWriter, capturePair[1], captureFile);
+  }
+  std::thread bridge(hostBridge, mode, listenFd, std::cref(opt));
+
+  const int sock = socket(AF_INET, SOCK_STREAM, 0);
+  connect(sock, (sockaddr *)&addr, sizeof(addr));
+  while (clientFd[0] < 0)
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+  std::vector<double> lat;
+  uint64_t bytes = 0;
+  int64_t lastNs = 0;
+  const int64_t start = nowNs();
+  std::thread coordinator(fakeCoordinator, master, frames, gapUs, latency ? 0 : opt.baud);
+  readClient(sock, frames, lat, bytes, res, lastNs);
+  coordinator.join();
+  for (int i = 0; i < 2000 && bridgePingBusy(); i++)
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  stopBridge = true;
+  bridge.join();
+  stopResponder = true;
+  responder.join();
+  bridgePingResult(res.ping);
+  if (capture.joinable())
+  {
+    bridgeCaptureStop();
+    close(capturePair[0]);
+    capture.join();
+    close(capturePair[1]);
+    captureSink = -1;
+  }
+  if (captureFile)
+    fclose(captureFile);
+
+  const double secs = (lastNs > start ? lastNs - start : 1) / 1e9;
+  res.lost = frames - lat.size();
+  if (latency)
+  {
+    res.p50Us = percentile(lat, 0.50);
+    res.p99Us = percentile(lat, 0.99);
+  }
+  else
+  {
+    res.mbps = bytes / secs / 1e6;
+    res.fps = lat.size() / secs;
+  }
+  close(sock);
+  for (uint8_t cln = 0; cln < MAX_SOCKET_CLIENTS; cln++)
+  {
+    if (clientFd[cln] >= 0)
+      bridgeClientLost(cln, false);
+  }
+  close(listenFd);
+  close(uartFd);
+  close(master);
+  return true;
+}
+
+bool holdCheck(BRIDGE_COALESCE_t coalesce, const BenchOptions &opt, uint32_t waitMs, uint32_t &replayed, bool &ordered)
+{ // 20 frames and an SRSP without a client, waitMs later half a frame, the client and the rest live
+  const uint32_t held = 20;
+  const uint32_t live = 10;
+  const int master = openPty();
+  if (master < 0)
+    return false;
+  sockaddr_in addr;
+  const int listenFd = openListen(addr);
+  bridgeCoreInit();
+  BridgeCoreSettings.coalesce = coalesce;
+  BridgeCoreSettings.coalesceUs = opt.coalesceUs;
+  BridgeCoreSettings.coalesceBytes = opt.coalesceBytes;
+  BridgeCoreSettings.holdMs = 500;
+  timerDeadline = -1;
+  stopBridge = false;
+  std::thread bridge(hostBridge, HOST_MODE_TASK, listenFd, std::cref(opt));
+
+  uint8_t frame[MT_FRAME_MAX];
+  for (uint32_t seq = 0; seq < held; seq++)
+  {
+    masterPut(master, frame, makeFrame(frame, seq, 12 + (seq * 37) % 89));
+  }
+  const uint8_t srsp[] = {MT_SOF, 0x02, 0x61, 0x01, 0x59, 0x07, 0x3E}; // answers the client that left, not replayed
+  masterPut(master, srsp, sizeof(srsp));
+  std::this_thread::sleep_for(std::chrono::milliseconds(waitMs));
+  const size_t split = makeFrame(frame, held, 60); // cut in half by the connect, well within BRIDGE_FRAME_TIMEOUT_MS
+  masterPut(master, frame, split / 2);
+  std::this_thread::sleep_for(std::chrono::milliseconds(2));
+
+  const int sock = socket(AF_INET, SOCK_STREAM, 0);
+  connect(sock, (sockaddr *)&addr, sizeof(addr));
+  while (clientFd[0] < 0)
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  masterPut(master, frame + split / 2, split - split / 2);
+  for (uint32_t seq = held + 1; seq <= held + live; seq++)
+  {
+    masterPut(master, frame, makeFrame(frame, seq, 12 + (seq * 37) % 89));
+  }
+
+  MtParserStruct parser = {};
+  uint8_t buf[4096];
+  std::vector<uint32_t> seqs;
+  ordered = true;
+  pollfd pfd = {sock, POLLIN, 0};
+  while ((seqs.empty() || seqs.back() < held + live) && poll(&pfd, 1, 500) > 0)
+  {
+    const ssize_t n = recv(sock, buf, sizeof(buf), 0);
+    if (n <= 0)
+      break;
+    for (ssize_t i = 0; i < n; i++)
+    {
+      if (mtParserFeed(parser, buf[i]) == 0)
+        continue;
+      uint32_t seq;
+      memcpy(&seq, parser.frame + MT_HEADER_LEN, sizeof(seq));
+      ordered &= parser.frame[2] == 0x44 && (seqs.empty() ? seq == 0 || seq == held : seq == seqs.back() + 1);
+      seqs.push_back(seq);
+    }
+  }
+  ordered &= parser.resyncs == 0 && !seqs.empty() && seqs.back() == held + live;
+  replayed = BridgeStats.holdReplayed;
+  stopBridge = true;
+  bridge.join();
+  close(sock);
+  for (uint8_t cln = 0; cln < MAX_SOCKET_CLIENTS; cln++)
+  {
+    if (clientFd[cln] >= 0)
+      bridgeClientLost(cln, false);
+  }
+  close(listenFd);
+  close(uartFd);
+  close(master);
+  return true;
+}
+
+size_t hexLineSprintf(char *line, const char *dir, const uint8_t *data, size_t chunk)
+{ // printSocketTraffic() before hexFormat()
+  size_t len = sprintf(line, "%s", dir);
+  for (size_t i = 0; i < chunk; i++)
+    len += sprintf(line + len, " %02x", data[i]);
+  return len;
+}
+
+size_t hexLineTable(char *line, const char *dir, const uint8_t *data, size_t chunk)
+{
+  const size_t dirLen = strlen(dir);
+  memcpy(line, dir, dirLen);
+  return dirLen + hexFormat(line + dirLen, data, chunk);
+}
+
+double hexRun(size_t (*format)(char *, const char *, const uint8_t *, size_t), const std::vector<uint8_t> &data, uint32_t &sum)
+{ // ns per byte, 64 bytes per line like BRIDGE_LOG_LINE_BYTES
+  char line[24 + 64 * 3 + 1];
+  sum = 0;
+  const int64_t start = nowNs();
+  for (size_t at = 0; at < data.size(); at += 64)
+  {
+    const size_t len = format(line, "<-", data.data() + at, std::min<size_t>(64, data.size() - at));
+    for (size_t i = 0; i < len; i++)
+      sum = sum * 31 + (uint8_t)line[i]; // what logWrite() would copy
+  }
+  return (double)(nowNs() - start) / data.size();
+}
+
+int main(int argc, char **argv)
+{
+  BenchOptions opt;
+  for (int i = 1; i + 1 < argc; i += 2)
+  {
+    const uint32_t v = strtoul(argv[i + 1], NULL, 0);
+    if (!strcmp(argv[i], "--frames"))
+      opt.frames = v;
+    else if (!strcmp(argv[i], "--latency-frames"))
+      opt.latencyFrames = v;
+    else if (!strcmp(argv[i], "--gap-us"))
+      opt.gapUs = v;
+    else if (!strcmp(argv[i], "--baud"))
+      opt.baud = v;
+    else if (!strcmp(argv[i], "--loop-us"))
+      opt.loopUs = v;
+    else if (!strcmp(argv[i], "--coalesce-us"))
+      opt.coalesceUs = v;
+    else if (!strcmp(argv[i], "--pings"))
+      opt.pings = std::min<uint32_t>(v, BRIDGE_PING_MAX);
+    else if (!strcmp(argv[i], "--late-every"))
+      opt.lateEvery = v;
+    else if (!strcmp(argv[i], "--hex-bytes"))
+      opt.hexBytes = std::max<uint32_t>(v, 64);
+    else if (!strcmp(argv[i], "--capture"))
+      capturePath = argv[i + 1];
+    else if (!strcmp(argv[i], "--coalesce-bytes"))
+      opt.coalesceBytes = std::min<uint32_t>(v, BRIDGE_BUF_SIZE);
+    else
+    {
+      fprintf(stderr, "usage: %s [--frames N] [--latency-frames N] [--gap-us US] [--baud B] [--loop-us US] [--coalesce-us US] [--coalesce-bytes N] [--pings N] [--late-every N] [--hex-bytes N] [--capture FILE]\n", argv[0]);
+      return 2;
+    }
+  }
+
+  const char *modes[] = {"loop", "task"};
+  const char *policies[] = {"immediate", "batch", "frame"};
+  printf("%-5s %-10s %9s %10s %9s %9s %6s %6s %9s %9s %9s %7s\n", "mode", "coalesce", "MB/s", "frames/s", "p50 us", "p99 us", "lost", "badFcs",
+         "ping p50", "ping p99", "ping lost", "leaked");
+  for (uint8_t mode = HOST_MODE_LOOP; mode <= HOST_MODE_TASK; mode++)
+  {
+    for (uint8_t policy = BRIDGE_COALESCE_IMMEDIATE; policy <= BRIDGE_COALESCE_FRAME; policy++)
+    {
+      BenchResult res = {};
+      BenchResult lat = {};
+      if (!runPhase((HOST_MODE_t)mode, (BRIDGE_COALESCE_t)policy, opt, opt.frames, 0, res, false) ||
+          !runPhase((HOST_MODE_t)mode, (BRIDGE_COALESCE_t)policy, opt, opt.latencyFrames, opt.gapUs, lat, true))
+      {
+        perror("pty");
+        return 1;
+      }
+      printf("%-5s %-10s %9.2f %10.0f %9.0f %9.0f %6u %6u %9u %9u %9u %7u\n", modes[mode], policies[policy], res.mbps, res.fps,
+             lat.p50Us, lat.p99Us, res.lost + lat.lost, res.badFcs + lat.badFcs,
+             lat.ping.p50Us, lat.ping.p99Us, lat.ping.sent - lat.ping.answered, res.foreign + lat.foreign);
+    }
+  }
+  printf("\n%-10s %16s %16s\n", "hold-down", "reconnect 100ms", "reconnect 1s");
+  for (uint8_t policy = BRIDGE_COALESCE_IMMEDIATE; policy <= BRIDGE_COALESCE_FRAME; policy++)
+  { // TTL 500 ms: everything replayed after a short gap, nothing after a long one
+    uint32_t quick, slow;
+    bool quickOk, slowOk;
+    if (!holdCheck((BRIDGE_COALESCE_t)policy, opt, 100, quick, quickOk) || !holdCheck((BRIDGE_COALESCE_t)policy, opt, 1000, slow, slowOk))
+    {
+      perror("pty");
+      return 1;
+    }
+    printf("%-10s %9u/20 %-4s %9u/20 %-4s\n", policies[policy], quick, quickOk ? "ok" : "BAD", slow, slowOk ? "ok" : "BAD");
+  }
+
+  std::vector<uint8_t> hexData(opt.hexBytes);
+  for (size_t i = 0; i < hexData.size(); i++)
+    hexData[i] = (uint8_t)(i * 7 + (i >> 8));
+  uint32_t sumSprintf, sumTable;
+  hexRun(hexLineTable, hexData, sumTable); // warm up
+  const double nsSprintf = hexRun(hexLineSprintf, hexData, sumSprintf);
+  const double nsTable = hexRun(hexLineTable, hexData, sumTable);
+  printf("\n%-10s %12s %12s %8s\n", "hex dump", "sprintf ns/B", "table ns/B", "output");
+  printf("%-10s %12.2f %12.2f %8s\n", "", nsSprintf, nsTable, sumSprintf == sumTable ? "same" : "BAD");
+  return 0;
+}
@@ -0,0 +1,17 @@
+#!/bin/bash
+# Builds the bridge core for the host together with the pty benchmark into _host/bridge_bench.
+#
+# The same sources make up a PlatformIO native environment:
+#
+#   [env:native]
+#   platform = native
+#   build_flags = -std=gnu++17 -pthread -Isrc
+#   build_src_filter = -<*> +<bridge_core.cpp> +<hex.cpp> +<mt.cpp> +<pcapng.cpp> +<recorder.cpp> +<../tools/bridge_host/bridge_host.cpp>
+#
+#   pio run -e native && .pio/build/native/program
+
+cd "$(dirname "$0")/../.."
+mkdir -p _host
+${CXX:-g++} -std=gnu++17 -O2 -Wall -Wextra -pthread -Isrc \
+  src/bridge_core.cpp src/hex.cpp src/mt.cpp src/pcapng.cpp src/recorder.cpp tools/bridge_host/bridge_host.cpp \
+  -o _host/bridge_bench
@@ -0,0 +1,65 @@
+#!/usr/bin/env python3
+# Converts a flight recorder snapshot (/api?action=14) into pcapng for Wireshark (see tools/znp.lua).
+#
+#   python3 tools/recorder2pcapng.py http://192.168.1.10/api?action=14 znp.pcapng
+#   python3 tools/recorder2pcapng.py znp-recorder.bin znp.pcapng
+#
+# Record times are milliseconds since boot; they are placed on the wall clock of the snapshot, or
+# counted from the epoch when the gateway had no time yet.
+
+import struct
+import sys
+import time
+import urllib.request
+
+MAGIC = 0x52504E5A  # "ZNPR"
+HEADER = struct.Struct("<IHHIIIIQ")
+LINKTYPE_USER0 = 147
+DIR_ZB_TO_NET = 0
+
+
+def block(block_type, body):
+    body += b"\0" * (-len(body) % 4)
+    total = 12 + len(body)
+    return struct.pack("<II", block_type, total) + body + struct.pack("<I", total)
+
+
+def convert(snapshot):
+    magic, version, header_len, uptime_ms, records, dropped, _, wall_us = HEADER.unpack_from(snapshot)
+    if magic != MAGIC or version != 1:
+        raise ValueError("not a flight recorder snapshot")
+    base_us = wall_us - uptime_ms * 1000 if wall_us else 0
+    out = [block(0x0A0D0D0A, struct.pack("<IHHq", 0x1A2B3C4D, 1, 0, -1)),
+           block(1, struct.pack("<HHI", LINKTYPE_USER0, 0, 0))]
+    pos = header_len
+    for _ in range(records):
+        time_ms, direction = struct.unpack_from("<IB", snapshot, pos)
+        frame = snapshot[pos + 5:pos + 5 + snapshot[pos + 6] + 5]
+        pos += 5 + len(frame)
+        ts = base_us + time_ms * 1000
+        flags = 1 if direction == DIR_ZB_TO_NET else 2  # inbound from the coordinator / outbound to it
+        epb = struct.pack("<IIIII", 0, ts >> 32, ts & 0xFFFFFFFF, len(frame), len(frame)) + frame
+        epb += b"\0" * (-len(epb) % 4) + struct.pack("<HHIHH", 2, 4, flags, 0, 0)
+        out.append(block(6, epb))
+    return b"".join(out), records, dropped, wall_us
+
+
+def main():
+    if len(sys.argv) != 3:
+        sys.exit(__doc__ or "usage: recorder2pcapng.py <snapshot file or url> <out.pcapng>")
+    src, dst = sys.argv[1:]
+    if src.startswith("http://") or src.startswith("https://"):
+        with urllib.request.urlopen(src, timeout=10) as resp:
+            snapshot = resp.read()
+    else:
+        with open(src, "rb") as f:
+            snapshot = f.read()
+    pcap, records, dropped, wall_us = convert(snapshot)
+    with open(dst, "wb") as f:
+        f.write(pcap)
+    when = time.strftime("%Y-%m-%d %H:%M:%S", time.localtime(wall_us / 1e6)) if wall_us else "clock not set"
+    print(f"{records} frames ({dropped} older ones overwritten), snapshot at {when} -> {dst}")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,137 @@
+#!/usr/bin/env python3
+# Cost of the TLS bridge port compared with the plaintext one.
+#
+# Handshake: --connects fresh TLS connections (full ECDHE handshake), then as many
+# that offer the session of the first one (ticket / session id resumption).
+# Steady state: SYS_PING round trips through the plaintext port and through the
+# TLS port, and the bytes every write costs on the wire.
+# The gateway's own handshake timings are read from /api?action=13.
+#
+#   python3 tools/tls_bench.py 192.168.1.10 --tls-port 6643
+#   python3 tools/tls_bench.py 192.168.1.10 --port 6638 --tls-port 6643 --count 1000
+#
+# Stop zigbee2mqtt / ZHA first, see bridge_bench.py.
+
+import argparse
+import json
+import socket
+import ssl
+import time
+import urllib.request
+
+from bridge_bench import SYS_PING, read_frame, report
+
+SRSP_SYS_PING = 7  # SOF, len, cmd0, cmd1, 2 byte capabilities, FCS
+
+
+def tls_context():
+    ctx = ssl.SSLContext(ssl.PROTOCOL_TLS_CLIENT)
+    ctx.check_hostname = False
+    ctx.verify_mode = ssl.CERT_NONE  # self-signed on the gateway, the numbers are what matters here
+    ctx.maximum_version = ssl.TLSVersion.TLSv1_2
+    return ctx
+
+
+def tls_connect(ctx, host, port, timeout, session=None):
+    """Return (socket, tcp connect ms, handshake ms)."""
+    start = time.perf_counter()
+    raw = socket.create_connection((host, port), timeout=timeout)
+    raw.setsockopt(socket.IPPROTO_TCP, socket.TCP_NODELAY, 1)
+    connected = time.perf_counter()
+    sock = ctx.wrap_socket(raw, session=session)
+    done = time.perf_counter()
+    return sock, (connected - start) * 1000.0, (done - connected) * 1000.0
+
+
+def handshakes(host, port, count, timeout):
+    ctx = tls_context()
+    full = []
+    resumed = []
+    not_resumed = 0
+    session = None
+    for _ in range(count):
+        sock, _, ms = tls_connect(ctx, host, port, timeout)
+        full.append(ms)
+        sock.recv(0)  # TLS 1.2 tickets arrive with the handshake, nothing to wait for
+        session = sock.session
+        sock.close()
+    for _ in range(count):
+        sock, _, ms = tls_connect(ctx, host, port, timeout, session)
+        if sock.session_reused:
+            resumed.append(ms)
+        else:
+            not_resumed += 1
+            full.append(ms)
+        session = sock.session
+        sock.close()
+    return full, resumed, not_resumed, ctx
+
+
+def ping(sock, count):
+    rtts = []
+    lost = 0
+    buf = bytearray()
+    for _ in range(count):
+        start = time.perf_counter()
+        sock.sendall(SYS_PING)
+        try:
+            while True:
+                cmd0, cmd1, _ = read_frame(sock, buf)
+                if cmd0 == 0x61 and cmd1 == 0x01:
+                    break
+            rtts.append((time.perf_counter() - start) * 1000.0)
+        except socket.timeout:
+            lost += 1
+            buf.clear()
+    return rtts, lost
+
+
+def gateway_tls(host):
+    try:
+        with urllib.request.urlopen(f"http://{host}/api?action=13", timeout=5) as resp:
+            return json.load(resp).get("tls")
+    except (OSError, ValueError):
+        return None
+
+
+def main():
+    parser = argparse.ArgumentParser(description="TLS bridge port: handshake and steady-state overhead")
+    parser.add_argument("host")
+    parser.add_argument("--port", type=int, default=6638, help="plaintext bridge port")
+    parser.add_argument("--tls-port", type=int, required=True, help="TLS bridge port")
+    parser.add_argument("--connects", type=int, default=10, help="full and resumed handshakes each")
+    parser.add_argument("--count", type=int, default=500, help="pings per port")
+    parser.add_argument("--timeout", type=float, default=5.0, help="seconds per connect or ping")
+    args = parser.parse_args()
+
+    full, resumed, not_resumed, ctx = handshakes(args.host, args.tls_port, args.connects, args.timeout)
+    report("full hs", full, 0)
+    report("resumed", resumed, not_resumed, " (lost = resumption refused)")
+
+    with socket.create_connection((args.host, args.port), timeout=args.timeout) as sock:
+        sock.setsockopt(socket.IPPROTO_TCP, socket.TCP_NODELAY, 1)
+        plain, plain_lost = ping(sock, args.count)
+    sock, _, _ = tls_connect(ctx, args.host, args.tls_port, args.timeout)
+    with sock:
+        cipher = sock.cipher()
+        tls, tls_lost = ping(sock, args.count)
+    report("plain", plain, plain_lost)
+    report("tls", tls, tls_lost)
+    if plain and tls:
+        plain.sort()
+        tls.sort()
+        print(f"{'tls cost':>10}: p50 +{tls[len(tls) // 2] - plain[len(plain) // 2]:.2f} ms per round trip")
+
+    # AES-GCM record: 5 byte header, 8 byte explicit nonce, 16 byte tag
+    overhead = 5 + 8 + 16 if "GCM" in cipher[0] else None
+    if overhead:
+        print(f"{'wire':>10}: {cipher[0]}, +{overhead} B per write: SYS_PING {len(SYS_PING)} -> "
+              f"{len(SYS_PING) + overhead} B, SRSP {SRSP_SYS_PING} -> {SRSP_SYS_PING + overhead} B")
+    gateway = gateway_tls(args.host)
+    if gateway:
+        print(f"{'gateway':>10}: full {gateway['fullAvgMs']} ms avg ({gateway['full']}), "
+              f"resumed {gateway['resumedAvgMs']} ms avg ({gateway['resumed']}), {gateway['failed']} failed")
+
+
+if __name__ == "__main__":
+    main()
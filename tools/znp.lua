@@ -0,0 +1,54 @@
+-- Wireshark dissector for the gateway's ZNP capture port (pcapng, LINKTYPE_USER0).
+--
+--   wireshark -X lua_script:tools/znp.lua -k -i TCP@192.168.1.10:6639
+--   nc 192.168.1.10 6639 | wireshark -X lua_script:tools/znp.lua -k -i -
+--
+-- Each packet is one TI Monitor & Test frame: SOF, len, cmd0, cmd1, payload, FCS.
+-- The direction is in the packet flags: inbound = from the CC2652, outbound = to it.
+
+local znp = Proto("znp", "TI ZNP (Monitor & Test)")
+
+local types = { [0] = "POLL", [1] = "SREQ", [2] = "AREQ", [3] = "SRSP" }
+local subsystems = {
+	[0] = "RPC_ERROR", [1] = "SYS", [2] = "MAC", [3] = "NWK", [4] = "AF", [5] = "ZDO",
+	[6] = "SAPI", [7] = "UTIL", [8] = "DEBUG", [9] = "APP", [15] = "APP_CNF", [21] = "GREENPOWER",
+}
+
+local f = znp.fields
+f.sof = ProtoField.uint8("znp.sof", "SOF", base.HEX)
+f.len = ProtoField.uint8("znp.len", "Length", base.DEC)
+f.type = ProtoField.uint8("znp.type", "Type", base.DEC, types, 0xE0)
+f.subsystem = ProtoField.uint8("znp.subsystem", "Subsystem", base.DEC, subsystems, 0x1F)
+f.cmd1 = ProtoField.uint8("znp.cmd1", "Command ID", base.HEX)
+f.payload = ProtoField.bytes("znp.payload", "Payload")
+f.fcs = ProtoField.uint8("znp.fcs", "FCS", base.HEX)
+
+function znp.dissector(buf, pinfo, tree)
+	if buf:len() < 5 then
+		return 0
+	end
+	pinfo.cols.protocol = "ZNP"
+	local len = buf(1, 1):uint()
+	local cmd0 = buf(2, 1):uint()
+	local cmd1 = buf(3, 1):uint()
+	local name = (types[bit.rshift(cmd0, 5)] or "?") .. " " ..
+		(subsystems[bit.band(cmd0, 0x1F)] or string.format("0x%02x", bit.band(cmd0, 0x1F))) ..
+		string.format(" 0x%02x", cmd1)
+	pinfo.cols.info = name
+
+	local t = tree:add(znp, buf(), "ZNP " .. name)
+	t:add(f.sof, buf(0, 1))
+	t:add(f.len, buf(1, 1))
+	t:add(f.type, buf(2, 1))
+	t:add(f.subsystem, buf(2, 1))
+	t:add(f.cmd1, buf(3, 1))
+	if len > 0 and buf:len() >= 4 + len then
+		t:add(f.payload, buf(4, len))
+	end
+	if buf:len() >= 5 + len then
+		t:add(f.fcs, buf(4 + len, 1))
+	end
+	return buf:len()
+end
+
+DissectorTable.get("wtap_encap"):add(wtap.USER0, znp)